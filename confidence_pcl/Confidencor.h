@@ -9,12 +9,49 @@ using namespace std;
 
 typedef unsigned char byte;
 
+//structure of arrays view of points handed to a Confidencor
+//point i is at x[i*stride], y[i*stride], z[i*stride] and strength[i*stride],
+//stride is 1 for separate arrays and the size of a point in floats for a point cloud
+struct conf_points{
+    const float* x;
+    const float* y;
+    const float* z;
+    float* strength;
+    int stride;
+    int size;
+};
+
+//view the points of a cloud without copying them
+inline conf_points getConfPoints(pcl::PointCloud<pcl::InterestPoint>::Ptr pc){
+    conf_points pts;
+    pcl::InterestPoint* first = pc->points.empty() ? NULL : &(pc->points[0]);
+    pts.x = first ? &(first->x) : NULL;
+    pts.y = first ? &(first->y) : NULL;
+    pts.z = first ? &(first->z) : NULL;
+    pts.strength = first ? &(first->strength) : NULL;
+    pts.stride = sizeof(pcl::InterestPoint)/sizeof(float);
+    pts.size = pc->points.size();
+    return pts;
+}
+
+//assigns confidences to predicted points (strength<0) from the observed points (strength 1)
+//prepare is called once with every point, then assign_range on ranges of points which may
+//run at the same time on different threads
 class Confidencor
 {
 public:
     Confidencor(){}
     virtual ~Confidencor(){}
-    virtual void conf_assigner(pcl::PointCloud<pcl::InterestPoint>::Ptr pc) = 0;
+    //build whatever the assignment needs from the observed points
+    virtual void prepare(const conf_points& pts){}
+    //assign confidences to the predicted points in [begin,end)
+    virtual void assign_range(const conf_points& pts, int begin, int end) const = 0;
+    //assign confidences to all predicted points of the cloud
+    virtual void conf_assigner(pcl::PointCloud<pcl::InterestPoint>::Ptr pc){
+        conf_points pts = getConfPoints(pc);
+        prepare(pts);
+        assign_range(pts, 0, pts.size);
+    }
 
 };
 
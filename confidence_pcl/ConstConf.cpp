@@ -12,10 +12,11 @@ typedef unsigned char byte;
 
 ConstConf::ConstConf(float conf):confidence(conf){}
 
-void ConstConf::conf_assigner(pcl::PointCloud<pcl::InterestPoint>::Ptr pc){
-    for(int i=0; i<pc->points.size(); i++){
-        if(pc->points[i].strength<0){
-            pc->points[i].strength = confidence;
+void ConstConf::assign_range(const conf_points& pts, int begin, int end) const{
+    float* strength = pts.strength;
+    for(int i=begin; i<end; i++){
+        if(strength[i*pts.stride]<0){
+            strength[i*pts.stride] = confidence;
         }
     }
 }
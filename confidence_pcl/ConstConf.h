@@ -17,7 +17,7 @@ private:
     float confidence;
 public:
     ConstConf(float conf);
-    virtual void conf_assigner(pcl::PointCloud<pcl::InterestPoint>::Ptr pc);
+    virtual void assign_range(const conf_points& pts, int begin, int end) const;
 };
 
 #endif
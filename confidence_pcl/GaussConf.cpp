@@ -2,41 +2,143 @@
 #include <pcl/kdtree/kdtree_flann.h>
 
 #include <stdlib.h>
+#include <math.h>
 
 #include "Confidencor.h"
 #include "GaussConf.h"
+#include "assign_confidence.h"
 
 using namespace std;
 
 typedef unsigned char byte;
 
-GaussConf::GaussConf(float var):variance(var){}
+//build the cutoff grid of the observed points, empty when it would be too large
+void getCutoffCells(const conf_points& pts, const vector<int>& observed, float side, cutoff_cells& cells){
+    cells.occupied.clear();
+    int s = pts.stride;
+    Eigen::Vector3f lo (pts.x[observed[0]*s], pts.y[observed[0]*s], pts.z[observed[0]*s]);
+    Eigen::Vector3f hi = lo;
+    for(int i=1; i<observed.size(); i++){
+        Eigen::Vector3f p (pts.x[observed[i]*s], pts.y[observed[i]*s], pts.z[observed[i]*s]);
+        lo = lo.cwiseMin(p);
+        hi = hi.cwiseMax(p);
+    }
+    double total = 1;
+    for(int a=0; a<3; a++){
+        cells.dims[a] = (int)floor((hi[a]-lo[a])/side)+1;
+        total *= cells.dims[a];
+    }
+    if(total>GAUSS_CONF_MAX_CELLS) return;
 
-void GaussConf::conf_assigner(pcl::PointCloud<pcl::InterestPoint>::Ptr pc){
-    //create a copy of the observed point cloud
-    pcl::PointCloud<pcl::InterestPoint>::Ptr observed (new pcl::PointCloud<pcl::InterestPoint>());
-    for(int i=0; i<pc->points.size(); i++){
-        if(pc->points[i].strength==1.0){
-            observed->push_back(pc->points[i]);
+    cells.origin = lo;
+    cells.side = side;
+    cells.occupied.assign((int)total, 0);
+    for(int i=0; i<observed.size(); i++){
+        int c[3];
+        c[0] = (int)floor((pts.x[observed[i]*s]-lo[0])/side);
+        c[1] = (int)floor((pts.y[observed[i]*s]-lo[1])/side);
+        c[2] = (int)floor((pts.z[observed[i]*s]-lo[2])/side);
+        cells.occupied[(c[2]*cells.dims[1]+c[1])*cells.dims[0]+c[0]] = 1;
+    }
+}
+
+//indexes of the observed points
+vector<int> getObserved(const conf_points& pts){
+    vector<int> observed;
+    for(int i=0; i<pts.size; i++){
+        if(pts.strength[i*pts.stride]==1.0) observed.push_back(i);
+    }
+    return observed;
+}
+
+//true when an observed point may lie within one cell side of p
+bool nearObserved(const cutoff_cells& cells, const pcl::InterestPoint& p){
+    if(cells.occupied.empty()) return true;
+    int c[3];
+    c[0] = (int)floor((p.x-cells.origin[0])/cells.side);
+    c[1] = (int)floor((p.y-cells.origin[1])/cells.side);
+    c[2] = (int)floor((p.z-cells.origin[2])/cells.side);
+    for(int z=max(c[2]-1, 0); z<=min(c[2]+1, cells.dims[2]-1); z++){
+        for(int y=max(c[1]-1, 0); y<=min(c[1]+1, cells.dims[1]-1); y++){
+            for(int x=max(c[0]-1, 0); x<=min(c[0]+1, cells.dims[0]-1); x++){
+                if(cells.occupied[(z*cells.dims[1]+y)*cells.dims[0]+x]) return true;
+            }
         }
     }
+    return false;
+}
+
+GaussConf::GaussConf(float var, float cutoff_in, int threads_in):variance(var), cutoff(cutoff_in), threads(threads_in), searchable(false){}
+
+void GaussConf::prepare(const conf_points& pts){
+    vector<int> observed = getObserved(pts);
+    searchable = !observed.empty();
+    cells.occupied.clear();
+    kdtree.reset();
+    if(!searchable) return;
+
+    //copy observed points for the kd tree
+    pcl::PointCloud<pcl::InterestPoint>::Ptr copy (new pcl::PointCloud<pcl::InterestPoint>());
+    copy->points.resize(observed.size());
+    for(int i=0; i<observed.size(); i++){
+        pcl::InterestPoint& p = copy->points[i];
+        p.x = pts.x[observed[i]*pts.stride]; p.y = pts.y[observed[i]*pts.stride]; p.z = pts.z[observed[i]*pts.stride];
+        p.strength = 1.0;
+    }
+    kdtree.reset(new pcl::KdTreeFLANN<pcl::InterestPoint>());
+    kdtree->setInputCloud(copy);
+
+    //cutoff occupancy grid
+    if(cutoff>0) getCutoffCells(pts, observed, cutoff*sqrt(variance), cells); //<-------------------------------------------------need a way to compute reasonable variance
+}
+
+void GaussConf::assign_range(const conf_points& pts, int begin, int end) const{
+    float radius = cutoff*sqrt(variance);
+    float cutoff_sq = radius*radius;
+    vector<int> idx (1);
+    vector<float> dist (1);
+    //predicted points of the current block and their squared distances, -1 beyond the cutoff
+    vector<int> queries;
+    queries.reserve(GAUSS_CONF_BLOCK);
+    Eigen::ArrayXf d2 (GAUSS_CONF_BLOCK);
 
-    //create kd tree
-    pcl::KdTreeFLANN<pcl::InterestPoint> kdtree;
-    kdtree.setInputCloud(observed);
-
-    for(int i=0; i<pc->points.size(); i++){
-        if(pc->points[i].strength<0.0){
-            //perform nearest neighbor search
-            vector<int> pointIdxNKNSearch(1);
-            vector<float> pointNKNSquaredDistance(1);
-            kdtree.nearestKSearch(pc->points[i], 1, pointIdxNKNSearch, pointNKNSquaredDistance);
-            //get distance
-            float dist = (float) sqrt((double)pointNKNSquaredDistance[0]);
-            //compute new confidence from gaussian
-            float exp = -dist*dist/(2*variance); //<-------------------------------------------------need a way to compute reasonable variance
-            float gauss = pow(2.71828f,exp);
-            pc->points[i].strength = gauss;
+    int i = begin;
+    while(i<end){
+        //squared distances of the block
+        queries.clear();
+        for(; i<end && queries.size()<GAUSS_CONF_BLOCK; i++){
+            if(pts.strength[i*pts.stride]>=0.0) continue;
+            pcl::InterestPoint p;
+            p.x = pts.x[i*pts.stride]; p.y = pts.y[i*pts.stride]; p.z = pts.z[i*pts.stride];
+            float d = -1.0;
+            if(searchable && nearObserved(cells, p) && kdtree->nearestKSearch(p, 1, idx, dist)>0){
+                d = dist[0];
+                if(cutoff_sq>0 && d>cutoff_sq) d = -1.0;
+            }
+            d2[queries.size()] = d;
+            queries.push_back(i);
         }
+        //gaussians of the block
+        int n = queries.size();
+        Eigen::ArrayXf gauss = (d2.head(n)*(-0.5f/variance)).exp();
+        for(int q=0; q<n; q++){
+            pts.strength[queries[q]*pts.stride] = d2[q]<0 ? 0.0f : gauss[q];
+        }
+    }
+}
+
+void GaussConf::conf_assigner(pcl::PointCloud<pcl::InterestPoint>::Ptr pc){
+    conf_points pts = getConfPoints(pc);
+    boost::shared_ptr<vector<int> > observed (new vector<int>(getObserved(pts)));
+    searchable = !observed->empty();
+    cells.occupied.clear();
+    if(searchable){
+        //create kd tree over the observed points of the cloud
+        kdtree.reset(new pcl::KdTreeFLANN<pcl::InterestPoint>());
+        kdtree->setInputCloud(pc, observed);
+        if(cutoff>0) getCutoffCells(pts, *observed, cutoff*sqrt(variance), cells);
     }
+    assignRanges(this, pts, threads);
+    kdtree.reset();
+    searchable = false;
 }
@@ -12,11 +12,39 @@ using namespace std;
 
 typedef unsigned char byte;
 
+//queries whose gaussians are evaluated together
+const int GAUSS_CONF_BLOCK = 4096;
+//largest number of cells of the cutoff occupancy grid, beyond it every query is searched
+const int GAUSS_CONF_MAX_CELLS = 1<<24;
+
+//cells of side cutoff radius marking where observed points are
+struct cutoff_cells{
+    Eigen::Vector3f origin;
+    float side;
+    int dims[3];
+    vector<char> occupied;
+};
+
 class GaussConf: public Confidencor{
 private:
     float variance;
+    //radius in standard deviations beyond which confidence is 0, 0 for no cutoff
+    float cutoff;
+    //threads for the nearest neighbour queries, 0 uses all hardware threads
+    int threads;
+    //kd tree over the observed points, a copy of them or the indexes of a whole cloud
+    bool searchable;
+    boost::shared_ptr< pcl::KdTreeFLANN<pcl::InterestPoint> > kdtree;
+    cutoff_cells cells;
 public:
-    GaussConf(float var);
+    GaussConf(float var, float cutoff_in=0.0, int threads_in=0);
+    virtual void prepare(const conf_points& pts);
+    //confidence of every predicted point from a gaussian of its distance to the closest
+    //observed point. with a cutoff, points with no observed point in the neighbouring
+    //cells of the cutoff grid are set to 0 without a search
+    virtual void assign_range(const conf_points& pts, int begin, int end) const;
+    //assigns the cloud on worker threads, the kd tree is built over the cloud in place
+    //and dropped after so no reference to the cloud is kept
     virtual void conf_assigner(pcl::PointCloud<pcl::InterestPoint>::Ptr pc);
 };
 
@@ -0,0 +1,79 @@
+#include <pcl/point_types.h>
+
+#include <stdlib.h>
+#include <math.h>
+
+#include "Confidencor.h"
+#include "GridConf.h"
+#include "edt.h"
+
+using namespace std;
+
+typedef unsigned char byte;
+
+GridConf::GridConf(float var, float voxel_size_in):variance(var), voxel_size(voxel_size_in){}
+
+void GridConf::prepare(const conf_points& pts){
+    sqdist.clear();
+    //bounds of the cloud
+    bool observed = false;
+    Eigen::Vector3f lo (0, 0, 0);
+    Eigen::Vector3f hi (0, 0, 0);
+    for(int i=0; i<pts.size; i++){
+        Eigen::Vector3f p (pts.x[i*pts.stride], pts.y[i*pts.stride], pts.z[i*pts.stride]);
+        if(i==0) lo = hi = p;
+        lo = lo.cwiseMin(p);
+        hi = hi.cwiseMax(p);
+        if(pts.strength[i*pts.stride]==1.0) observed = true;
+    }
+    if(!observed) return;
+
+    //voxel size that keeps the grid within GRID_CONF_MAX_VOXELS
+    size = voxel_size;
+    while(true){
+        double total = 1;
+        for(int a=0; a<3; a++){
+            dims[a] = (int)((hi[a]-lo[a])/size+0.5)+1;
+            total *= dims[a];
+        }
+        if(total<=GRID_CONF_MAX_VOXELS) break;
+        size *= 2;
+    }
+    if(size!=voxel_size) cout<<"confidence voxel size raised to "<<size<<endl;
+    origin = lo;
+
+    //rasterize observed points as the 0 distance voxels, in grid linear index order
+    sqdist.assign(dims[0]*dims[1]*dims[2], EDT_FAR);
+    for(int i=0; i<pts.size; i++){
+        if(pts.strength[i*pts.stride]!=1.0) continue;
+        int sub[3];
+        sub[0] = (int)((pts.x[i*pts.stride]-lo[0])/size+0.5);
+        sub[1] = (int)((pts.y[i*pts.stride]-lo[1])/size+0.5);
+        sub[2] = (int)((pts.z[i*pts.stride]-lo[2])/size+0.5);
+        sqdist[(sub[2]*dims[1]+sub[1])*dims[0]+sub[0]] = 0.0;
+    }
+
+    //distance of every voxel to the closest observed voxel
+    int d[3] = {dims[0], dims[1], dims[2]};
+    getSqDist(sqdist, d);
+}
+
+void GridConf::assign_range(const conf_points& pts, int begin, int end) const{
+    float scale = -size*size/(2*variance);
+    for(int i=begin; i<end; i++){
+        float& strength = pts.strength[i*pts.stride];
+        if(strength>=0.0) continue;
+        if(sqdist.empty()){
+            strength = 0.0;
+            continue;
+        }
+        //voxel of the point, clamped to the prepared grid
+        float p[3] = {pts.x[i*pts.stride], pts.y[i*pts.stride], pts.z[i*pts.stride]};
+        int sub[3];
+        for(int a=0; a<3; a++){
+            sub[a] = (int)floor((p[a]-origin[a])/size+0.5);
+            sub[a] = max(0, min(dims[a]-1, sub[a]));
+        }
+        strength = exp(sqdist[(sub[2]*dims[1]+sub[1])*dims[0]+sub[0]]*scale);
+    }
+}
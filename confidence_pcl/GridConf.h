@@ -0,0 +1,41 @@
+#ifndef GRIDCONF_H
+#define GRIDCONF_H
+
+#include <pcl/point_types.h>
+
+#include <stdlib.h>
+
+#include "Confidencor.h"
+#include "grid.h"
+
+using namespace std;
+
+typedef unsigned char byte;
+
+typedef boost::shared_ptr<grid> gridPtr;
+
+//largest number of voxels rasterized, the voxel size is doubled until the cloud fits
+const int GRID_CONF_MAX_VOXELS = 1<<27;
+
+class GridConf: public Confidencor{
+private:
+    float variance;
+    //side of the rasterization voxels, in cloud units
+    float voxel_size;
+    //rasterization built by prepare, size is voxel_size unless the grid had to shrink
+    Eigen::Vector3f origin;
+    Eigen::Vector3i dims;
+    float size;
+    //squared voxel distance of every voxel to the closest observed voxel
+    vector<float> sqdist;
+public:
+    GridConf(float var, float voxel_size_in);
+    //rasterize the observed points into voxels and run one distance transform over them
+    virtual void prepare(const conf_points& pts);
+    //confidence of every predicted point from a gaussian of its distance to the closest
+    //observed point, like GaussConf. distances are between voxel centers and may be off
+    //by up to a voxel diagonal
+    virtual void assign_range(const conf_points& pts, int begin, int end) const;
+};
+
+#endif
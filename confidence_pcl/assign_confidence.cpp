@@ -2,8 +2,12 @@
 
 #include <stdlib.h>
 
+#include <boost/thread/thread.hpp>
+#include <boost/bind/bind.hpp>
+
 #include "full_confidence.h"
 #include "Confidencor.h"
+#include "assign_confidence.h"
 
 using namespace std;
 
@@ -11,13 +15,66 @@ typedef unsigned char byte;
 
 
 pcl::PointCloud<pcl::InterestPoint>::Ptr assign_confidence(pcl::PointCloud<pcl::InterestPoint>::Ptr seed, pcl::PointCloud<pcl::PointXYZ>::Ptr cloud, Confidencor* f){
-    for(int i=0; i<cloud->points.size(); i++){
-        pcl::InterestPoint pnt;
+    //write predicted points after the seed in one resize
+    int start = seed->points.size();
+    int n = cloud->points.size();
+    seed->points.resize(start+n);
+    for(int i=0; i<n; i++){
+        pcl::InterestPoint& pnt = seed->points[start+i];
         pnt.x=cloud->points[i].x; pnt.y=cloud->points[i].y; pnt.z=cloud->points[i].z;
         pnt.strength=-1;
-        seed->push_back(pnt);
     }
+    seed->width = seed->points.size();
+    seed->height = 1;
     f->conf_assigner(seed);
 
     return seed;
 }
+
+//blocks of points shared by the worker threads
+struct conf_job{
+    const Confidencor* f;
+    const conf_points* pts;
+    //next block to take
+    int next;
+    boost::mutex lock;
+};
+
+//take blocks of points until none are left
+void confWorker(conf_job& job){
+    while(true){
+        int begin;
+        {
+            boost::mutex::scoped_lock guard (job.lock);
+            begin = job.next;
+            job.next += CONF_BLOCK;
+        }
+        if(begin>=job.pts->size) return;
+        job.f->assign_range(*job.pts, begin, min(job.pts->size, begin+CONF_BLOCK));
+    }
+}
+
+void assignRanges(const Confidencor* f, const conf_points& pts, int threads){
+    conf_job job;
+    job.f = f;
+    job.pts = &pts;
+    job.next = 0;
+
+    int nthreads = threads>0 ? threads : boost::thread::hardware_concurrency();
+    int nblocks = (pts.size+CONF_BLOCK-1)/CONF_BLOCK;
+    nthreads = max(1, min(nthreads, nblocks));
+    if(nthreads==1){
+        confWorker(job);
+        return;
+    }
+    boost::thread_group workers;
+    for(int t=0; t<nthreads; t++){
+        workers.create_thread(boost::bind(confWorker, boost::ref(job)));
+    }
+    workers.join_all();
+}
+
+void assignConfidences(Confidencor* f, const conf_points& pts, int threads){
+    f->prepare(pts);
+    assignRanges(f, pts, threads);
+}
@@ -12,6 +12,16 @@ using namespace std;
 
 typedef unsigned char byte;
 
+//points handed to a thread at a time by assignConfidences
+const int CONF_BLOCK = 4096;
+
 pcl::PointCloud<pcl::InterestPoint>::Ptr assign_confidence(pcl::PointCloud<pcl::InterestPoint>::Ptr seed, pcl::PointCloud<pcl::PointXYZ>::Ptr cloud, Confidencor* f);
 
+//assign the points with an already prepared f in blocks of CONF_BLOCK on threads worker
+//threads, 0 uses all hardware threads
+void assignRanges(const Confidencor* f, const conf_points& pts, int threads=0);
+
+//prepare f on the points and assign them with assignRanges
+void assignConfidences(Confidencor* f, const conf_points& pts, int threads=0);
+
 #endif
@@ -5,16 +5,19 @@
 
 #include "full_confidence.h"
 
-pcl::PointCloud<pcl::InterestPoint>::Ptr full_confidence(pcl::PointCloud<pcl::PointXYZ>::Ptr cloud){
+pcl::PointCloud<pcl::InterestPoint>::Ptr full_confidence(pcl::PointCloud<pcl::PointXYZ>::Ptr cloud, int extra){
     pcl::PointCloud<pcl::InterestPoint>::Ptr pc (new pcl::PointCloud<pcl::InterestPoint> ());
-    for(int i=0; i<cloud->points.size(); i++){
-        pcl::PointXYZ pnt = cloud->points[i];
-        pcl::InterestPoint p;
-        p.x=pnt.x; p.y=pnt.y; p.z=pnt.z;
+    int n = cloud->points.size();
+    pc->points.reserve(n+extra);
+    pc->points.resize(n);
+    for(int i=0; i<n; i++){
+        pcl::InterestPoint& p = pc->points[i];
+        p.x=cloud->points[i].x; p.y=cloud->points[i].y; p.z=cloud->points[i].z;
         p.strength=1.0;
         //p.strength=0.0;
-        pc->push_back(p);
     }
+    pc->width = n;
+    pc->height = 1;
 
     return pc;
 }
@@ -10,6 +10,8 @@ using namespace std;
 
 typedef unsigned char byte;
 
-pcl::PointCloud<pcl::InterestPoint>::Ptr full_confidence(pcl::PointCloud<pcl::PointXYZ>::Ptr cloud);
+//observed points with confidence 1, room is reserved for extra points to be added after
+//without the cloud growing again
+pcl::PointCloud<pcl::InterestPoint>::Ptr full_confidence(pcl::PointCloud<pcl::PointXYZ>::Ptr cloud, int extra=0);
 
 #endif
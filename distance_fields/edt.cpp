@@ -0,0 +1,87 @@
+
+#include "edt.h"
+
+using namespace std;
+
+//squared distance and closest site along one line of n voxels with the given stride
+void edtLine(float* f, int* site, int n, int stride, int* v, float* z, float* fv, int* sv){
+    //gather the line
+    int m=0;
+    for(int q=0; q<n; q++){
+        fv[q] = f[q*stride];
+        if(site) sv[q] = site[q*stride];
+    }
+    //lower envelope of the parabolas rooted at voxels with a finite distance
+    for(int q=0; q<n; q++){
+        if(fv[q]>=EDT_FAR) continue;
+        float s = -EDT_FAR;
+        while(m>0){
+            int p = v[m-1];
+            s = ((fv[q]+q*q)-(fv[p]+p*p))/(2.0f*(q-p));
+            if(s>z[m-1]) break;
+            m--;
+        }
+        if(m==0) s = -EDT_FAR;
+        v[m] = q;
+        z[m] = s;
+        m++;
+    }
+    if(m==0) return;
+    z[m] = EDT_FAR;
+    //evaluate the envelope
+    int k=0;
+    for(int q=0; q<n; q++){
+        while(z[k+1]<q) k++;
+        int p = v[k];
+        f[q*stride] = (q-p)*(q-p)+fv[p];
+        if(site) site[q*stride] = sv[p];
+    }
+}
+
+//one pass of 1D transforms along each axis, site may be NULL
+static void edtPasses(float* f, int* site, const int dims[3]){
+    int stride[3] = {1, dims[0], dims[0]*dims[1]};
+    int maxdim = max(dims[0], max(dims[1], dims[2]));
+    vector<int> v (maxdim);
+    vector<float> z (maxdim+1);
+    vector<float> fv (maxdim);
+    vector<int> sv (site ? maxdim : 0);
+    for(int a=0; a<3; a++){
+        int b = (a+1)%3;
+        int c = (a+2)%3;
+        for(int j=0; j<dims[b]; j++){
+            for(int k=0; k<dims[c]; k++){
+                int start = j*stride[b]+k*stride[c];
+                edtLine(f+start, site ? site+start : NULL, dims[a], stride[a], &v[0], &z[0], &fv[0],
+                    site ? &sv[0] : NULL);
+            }
+        }
+    }
+}
+
+//squared euclidean distance to the closest 0-value voxel and its linear index
+void getEDT(gridPtr volume_grid, vector<float>& sqdist, vector<int>& nearest){
+    int dims[3] = {volume_grid->dims[0], volume_grid->dims[1], volume_grid->dims[2]};
+    int size = dims[0]*dims[1]*dims[2];
+    vector<float> vol = flattenGrid(volume_grid);
+    sqdist.resize(size);
+    nearest.resize(size);
+    for(int i=0; i<size; i++){
+        if(vol[i]==0.0){
+            sqdist[i] = 0.0;
+            nearest[i] = i;
+        }
+        else{
+            sqdist[i] = EDT_FAR;
+            nearest[i] = -1;
+        }
+    }
+    if(size==0) return;
+    edtPasses(&sqdist[0], &nearest[0], dims);
+}
+
+//squared distance only, in place on a flat buffer
+void getSqDist(vector<float>& sqdist, const int dims[3]){
+    if(sqdist.empty() || sqdist.size()!=(size_t)dims[0]*dims[1]*dims[2]) return;
+    edtPasses(&sqdist[0], NULL, dims);
+}
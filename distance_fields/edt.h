@@ -0,0 +1,27 @@
+#ifndef EDT_H
+#define EDT_H
+
+#include "grid.h"
+
+using namespace std;
+
+typedef boost::shared_ptr<grid> gridPtr;
+
+//squared distance given to voxels when the grid has no 0-value voxel
+const float EDT_FAR = 1e20;
+
+//squared euclidean distance to the closest 0-value voxel and the linear index of that voxel,
+//one pass per axis, linear in the number of voxels (Felzenszwalb and Huttenlocher lower envelope).
+//sqdist and nearest are filled in linear index order, nearest is -1 without any 0-value voxel
+void getEDT(gridPtr volume_grid, vector<float>& sqdist, vector<int>& nearest);
+
+//squared distance only, in place on a flat buffer of dims voxels in grid linear index order.
+//sqdist holds 0 at the sites and EDT_FAR elsewhere on entry, needs no grid or closest sites
+void getSqDist(vector<float>& sqdist, const int dims[3]);
+
+//squared distance and closest site along one line of n voxels with the given stride
+//f holds the squared distance of each voxel so far and site its closest voxel, NULL for none,
+//v, z, fv and sv are scratch of at least n, n+1, n and n entries
+void edtLine(float* f, int* site, int n, int stride, int* v, float* z, float* fv, int* sv);
+
+#endif
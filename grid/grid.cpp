@@ -387,3 +387,18 @@ gridPtr getIndexMap(gridPtr band, const vector<int>& indexes){
     }
     return map_;
 }
+
+//get voxel values ordered by linear index
+vector<float> flattenGrid(gridPtr g){
+    vector<float> flat (g->dims[0]*g->dims[1]*g->dims[2], 0);
+    for(int i=0; i<g->dims[0]; i++){
+        for(int j=0; j<g->dims[1]; j++){
+            for(int k=0; k<g->dims[2]; k++){
+                Eigen::Vector3i pnt;
+                pnt[0]=i; pnt[1]=j; pnt[2]=k;
+                flat[g->sub2ind(pnt)] = (*g)[i][j][k];
+            }
+        }
+    }
+    return flat;
+}
@@ -103,4 +103,7 @@ vector<int> findIndexes(gridPtr band);
 //create index map
 gridPtr getIndexMap(gridPtr band, const vector<int>& indexes);
 
+//get voxel values ordered by linear index
+vector<float> flattenGrid(gridPtr g);
+
 #endif
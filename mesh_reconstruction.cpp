@@ -3,12 +3,15 @@
 #include "assign_confidence.h"
 
 #include "ConstConf.h"
+#include "GaussConf.h"
+#include "GridConf.h"
 
 #include "voxelize.h"
 
 #include "narrowBand.h"
 
 #include "quadprog.h"
+#include "qp_conf.h"
 
 #include "mcubes.h"
 
@@ -28,6 +31,9 @@ int main(int argc, char **argv){
     float CORNER_THRESHOLD = 0.8; //<-----------------decreasing raises sensitivity
     bool USING_FEATURES = false; //<------------------determines if feature detection is used
     bool USING_CUDA = false;     //<------------------determines if using GPU based algorithm
+    bool USING_CONFIDENCE = false; //<----------------determines if smoothing is weighted by confidences
+    float CONF_VOXEL = 0;        //<------------------voxel size of grid based confidences, 0 searches a kd tree
+    qp_options QP_OPTIONS;       //<------------------smoothing solver options
     //**************************************************************************************
 
     try {
@@ -36,6 +42,21 @@ int main(int argc, char **argv){
                 ("help", "produce help message")
                 ("feature-detection", po::bool_switch(&USING_FEATURES), "Toggle feature handling")
                 ("cuda", po::bool_switch(&USING_CUDA), "Toggle CUDA option")
+                ("confidence", po::bool_switch(&USING_CONFIDENCE), "Weight smoothing by observed vs predicted confidence (CPU, smoothing takes only --threads, --tolerance and --deadline)")
+                ("conf-voxel", po::value<float>(&CONF_VOXEL), "With --confidence, voxel size of a distance transform for confidences. Default: 0, kd tree")
+                ("matrix-free", po::bool_switch(&QP_OPTIONS.matrix_free), "Apply smoothing stencil without a sparse matrix (CPU)")
+                ("threads", po::value<int>(&QP_OPTIONS.threads), "Worker threads for CPU smoothing. Default: all cores")
+                ("sell", po::bool_switch(&QP_OPTIONS.sell), "Sweep a sliced ELLPACK copy of the smoothing matrix (CPU)")
+                ("packed", po::bool_switch(&QP_OPTIONS.packed), "Sweep an int8/int16 packed copy of the smoothing matrix (CPU)")
+                ("symmetric", po::bool_switch(&QP_OPTIONS.symmetric), "Store only the upper triangle of the smoothing matrix (CPU)")
+                ("domains", po::bool_switch(&QP_OPTIONS.domains), "Split the band into one z slab per smoothing thread (CPU)")
+                ("reorder", po::bool_switch(&QP_OPTIONS.reorder), "Number band unknowns in Morton order for locality")
+                ("time-steps", po::value<int>(&QP_OPTIONS.time_steps), "With --matrix-free, sweeps per cache sized tile. Default: 0, off")
+                ("direct", po::bool_switch(&QP_OPTIONS.direct), "Solve smoothing exactly with an active set method (CPU, small bands)")
+                ("presolve", po::value<int>(&QP_OPTIONS.presolve), "Sweeps before smoothing drops values held at a bound (CPU). Default: 0, off")
+                ("flat-band", po::value<float>(&QP_OPTIONS.flat_band), "Smoothing band radius away from features, 4 near them. Default: 0, fixed band")
+                ("tolerance", po::value<float>(&QP_OPTIONS.tol), "Stop smoothing once no value changes by more (CPU). Default: 0")
+                ("deadline", po::value<float>(&QP_OPTIONS.deadline), "Seconds allowed for smoothing, keeps the latest result after (CPU). Default: 0, none")
                 ("feature-threshold", po::value<float>(), "Increasing raises feature sensitivity. Default: 0.75")
                 ("corner-threshold", po::value<float>(), "Decreasing raises feature sensitivity. Default: 0.8")
                 ;
@@ -56,6 +77,53 @@ int main(int argc, char **argv){
             return 0;
         }
 
+        if(USING_CONFIDENCE) {
+            //confidence weighted smoothing only takes threads, tolerance and deadline
+            const char* ignored = NULL;
+            if(USING_CUDA) ignored = "--cuda";
+            else if(QP_OPTIONS.matrix_free) ignored = "--matrix-free";
+            else if(QP_OPTIONS.sell) ignored = "--sell";
+            else if(QP_OPTIONS.packed) ignored = "--packed";
+            else if(QP_OPTIONS.symmetric) ignored = "--symmetric";
+            else if(QP_OPTIONS.domains) ignored = "--domains";
+            else if(QP_OPTIONS.reorder) ignored = "--reorder";
+            else if(QP_OPTIONS.time_steps>0) ignored = "--time-steps";
+            else if(QP_OPTIONS.direct) ignored = "--direct";
+            else if(QP_OPTIONS.presolve>0) ignored = "--presolve";
+            else if(QP_OPTIONS.flat_band>0) ignored = "--flat-band";
+            if(ignored) {
+                cerr << "error: " << ignored << " cannot be used with --confidence" << endl;
+                return 1;
+            }
+            if(USING_FEATURES)
+                cerr << "warning: confidence weighted smoothing does not hold feature points, features only apply to marching cubes" << endl;
+            cout << "Using confidence weighted smoothing" << endl;
+        } else if(CONF_VOXEL>0) {
+            cerr << "error: --conf-voxel needs --confidence" << endl;
+            return 1;
+        }
+
+        //only one storage of the smoothing matrix is swept, and presolve sweeps the plain rows
+        const char* storage[4] = {"--sell", "--packed", "--symmetric", "--domains"};
+        bool stored[4] = {QP_OPTIONS.sell, QP_OPTIONS.packed, QP_OPTIONS.symmetric, QP_OPTIONS.domains};
+        const char* chosen = NULL;
+        for(int i=0; i<4; i++) {
+            if(!stored[i]) continue;
+            if(chosen) {
+                cerr << "error: " << storage[i] << " cannot be used with " << chosen << endl;
+                return 1;
+            }
+            chosen = storage[i];
+        }
+        if(chosen && QP_OPTIONS.presolve>0) {
+            cerr << "error: --presolve cannot be used with " << chosen << endl;
+            return 1;
+        }
+        if(QP_OPTIONS.time_steps>0 && !QP_OPTIONS.matrix_free) {
+            cerr << "error: --time-steps needs --matrix-free" << endl;
+            return 1;
+        }
+
         if(USING_FEATURES) {
             cout << "Using feature detection" << endl;
             USING_FEATURES = true;
@@ -106,15 +174,24 @@ int main(int argc, char **argv){
 
 
     /* Combine into pcl_conf with confidences */
-    Confidencor *confidence_assigner = new ConstConf(1); //<--- change confidencor function here
-    //assign full confidence to observeCloud
-    pcl::PointCloud<pcl::InterestPoint>::Ptr confPCL=full_confidence(observeCloud);
+    Confidencor *confidence_assigner;
+    if(USING_CONFIDENCE && CONF_VOXEL>0)
+        confidence_assigner = new GridConf(2.0, CONF_VOXEL);
+    else if(USING_CONFIDENCE)
+        confidence_assigner = new GaussConf(2.0); //<--- change confidencor function here
+    else
+        confidence_assigner = new ConstConf(1);
+    //assign full confidence to observeCloud, sized for the predicted points too
+    pcl::PointCloud<pcl::InterestPoint>::Ptr confPCL=full_confidence(observeCloud, predictCloud->points.size());
+    observeCloud.reset();
     //asign confidence to everything
     assign_confidence(confPCL, predictCloud, confidence_assigner);
+    predictCloud.reset();
 
 
     /* Voxelize the data */
-    voxelized_dataPtr data = voxelizeData(confPCL);
+    voxelized_dataPtr data = voxelizeData(confPCL, false);
+    confPCL.reset();
     //create grids
     gridPtr grid_cloud = createGrid(data->filtered_cloud, data->grid_data, res);
     gridPtr volume = getBinaryVolume(grid_cloud);
@@ -128,7 +205,11 @@ int main(int argc, char **argv){
     gridPtr featureMap = getFeatureMap(volume, surfaceMap, normals, FEATURE_THRESHOLD);
 
     /* Perform smoothing */
-    gridPtr F = optimize(volume, featureMap, USING_FEATURES, USING_CUDA);
+    gridPtr F;
+    if(USING_CONFIDENCE)
+        F = conf::optimize(grid_cloud, volume, QP_OPTIONS);
+    else
+        F = optimize(volume, featureMap, USING_FEATURES, USING_CUDA, QP_OPTIONS);
 
     /* Extract mesh and write to file */
     mcubes(F, surfaceMap, normals, 0.0, FEATURE_THRESHOLD, CORNER_THRESHOLD, output_path.c_str(), USING_FEATURES);
@@ -101,4 +101,53 @@ bandsPtr createBands(gridPtr margin, float band_size){
     return bnds;
 }
 
+//band radius of every voxel: band_size within grow voxels of a feature, flat_size elsewhere
+gridPtr getBandRadius(gridPtr featureMap, float band_size, float flat_size, int grow){
+    gridPtr near_feature = copyGrid(featureMap);
+    for(int n=0; n<grow; n++){
+        near_feature = dilate_grid(near_feature);
+    }
+    gridPtr radius = gridPtr(new grid(featureMap->dims, featureMap->scale, featureMap->shift, featureMap->pad));
+    for(int i=0; i<radius->dims[0]; i++){
+        for(int j=0; j<radius->dims[1]; j++){
+            for(int k=0; k<radius->dims[2]; k++){
+                if((*near_feature)[i][j][k]==1.0){
+                    (*radius)[i][j][k]=band_size;
+                }
+                else{
+                    (*radius)[i][j][k]=flat_size;
+                }
+            }
+        }
+    }
+    return radius;
+}
 
+//generate band and tight band with a radius chosen per surface voxel
+bandsPtr createAdaptiveBands(gridPtr margin, gridPtr nearest, gridPtr radius){
+    bandsPtr bnds = bandsPtr(new bands());
+    bnds->band = gridPtr(new grid(margin->dims, margin->scale, margin->shift, margin->pad));
+    int size = margin->dims[0]*margin->dims[1]*margin->dims[2];
+    //create band
+    for(int i=0; i<bnds->band->dims[0]; i++){
+        for(int j=0; j<bnds->band->dims[1]; j++){
+            for(int k=0; k<bnds->band->dims[2]; k++){
+                int surface = (int)(*nearest)[i][j][k];
+                float band_size = 0.0;
+                if(surface>=0 && surface<size){
+                    band_size = (*radius)(surface);
+                }
+                if((*margin)[i][j][k]<=band_size){
+                    (*(bnds->band))[i][j][k]=1.0;
+                }
+                else{
+                    (*(bnds->band))[i][j][k]=0.0;
+                }
+            }
+        }
+    }
+    bnds->tight_band = erode_grid(bnds->band);
+    bnds->band=dilate_grid(bnds->tight_band);
+
+    return bnds;
+}
@@ -23,4 +23,12 @@ gridPtr dilate_grid(gridPtr gr);
 //generate band and tight band (eroded band) using dist field "margin" and band_size
 bandsPtr createBands(gridPtr margin, float band_size);
 
+//band radius of every voxel: band_size within grow voxels of a feature, flat_size elsewhere
+gridPtr getBandRadius(gridPtr featureMap, float band_size, float flat_size, int grow);
+
+//generate band and tight band with a radius chosen per surface voxel
+//nearest holds the linear index of the closest surface voxel (getsqdist_index of the perimeter),
+//a voxel joins the band when its margin is within the radius at that surface voxel
+bandsPtr createAdaptiveBands(gridPtr margin, gridPtr nearest, gridPtr radius);
+
 #endif
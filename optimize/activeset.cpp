@@ -0,0 +1,163 @@
+
+#include "activeset.h"
+#include <iostream>
+
+using namespace std;
+
+ActiveSetSolver::ActiveSetSolver(){
+    key=0;
+}
+
+//hash of compressed sparse pattern
+size_t getPatternKey(const SparseMatrixD& A){
+    size_t h = 14695981039346656037ULL;
+    const int* outer = A.outerIndexPtr();
+    const int* inner = A.innerIndexPtr();
+    for(int i=0; i<=A.outerSize(); i++) h = (h^(size_t)outer[i])*1099511628211ULL;
+    for(int i=0; i<A.nonZeros(); i++) h = (h^(size_t)inner[i])*1099511628211ULL;
+    h = (h^(size_t)A.rows())*1099511628211ULL;
+    return h==0 ? 1 : h;
+}
+
+//assemble R+D in double with every diagonal entry stored
+void getFullSystem(SparseMatrixPtr R, const vector<float>& invdg, SparseMatrixD& A){
+    int n = R->rows();
+    vector<Eigen::Triplet<double> > trips;
+    trips.reserve(R->nonZeros()+n);
+    for(int j=0; j<R->outerSize(); j++){
+        for(Eigen::SparseMatrix<float>::InnerIterator it(*R, j); it; ++it){
+            trips.push_back(Eigen::Triplet<double>(it.row(), it.col(), it.value()));
+        }
+    }
+    for(int i=0; i<n; i++){
+        double dg = invdg[i]!=0.0 ? 1.0/invdg[i] : 0.0;
+        trips.push_back(Eigen::Triplet<double>(i, i, dg));
+    }
+    A.resize(n, n);
+    A.setFromTriplets(trips.begin(), trips.end());
+    A.makeCompressed();
+}
+
+//state of each unknown
+enum bound_state {FREE=0, LOWER=1, UPPER=2};
+
+//solve from x, R without diagonal and D given by its inverse invdg
+int ActiveSetSolver::solve(SparseMatrixPtr R, const vector<float>& invdg, const vector<float>& lb,
+    const vector<float>& ub, vector<float>& x, int maxIter)
+{
+    int n = x.size();
+    if(n==0) return 0;
+
+    getFullSystem(R, invdg, A);
+    const double* aval = A.valuePtr();
+    const int* outer = A.outerIndexPtr();
+    const int* inner = A.innerIndexPtr();
+
+    Eigen::VectorXd xd (n);
+    for(int i=0; i<n; i++) xd[i] = x[i];
+    //multipliers of the bounds, gradient of the objective at active unknowns
+    Eigen::VectorXd lambda = A*xd;
+    //scale of each row for the active set test
+    Eigen::VectorXd c = A.diagonal();
+    for(int i=0; i<n; i++) if(c[i]<1.0) c[i]=1.0;
+
+    vector<char> state (n, FREE);
+    vector<char> next (n, FREE);
+    vector<char> prev (n, FREE);
+    //unknowns that cycled between free and active are kept active
+    vector<char> frozen (n, FREE);
+    vector<int> fid (n, -1);
+    vector<Eigen::Triplet<double> > trips;
+    trips.reserve(A.nonZeros());
+    int it;
+    for(it=0; it<maxIter; it++){
+        //unknowns pushed against a bound become active
+        for(int i=0; i<n; i++){
+            next[i] = frozen[i];
+            if(lambda[i]+c[i]*(lb[i]-xd[i])>0) next[i] = LOWER;
+            else if(lambda[i]+c[i]*(ub[i]-xd[i])<0) next[i] = UPPER;
+        }
+        if(it>0 && next==state) break;
+        if(it>1 && next==prev){
+            //two set cycle, keep the unknowns that switch on their bound
+            for(int i=0; i<n; i++){
+                if(next[i]==state[i]) continue;
+                frozen[i] = (next[i]!=FREE) ? next[i] : state[i];
+                next[i] = frozen[i];
+            }
+        }
+        prev.swap(state);
+        state.swap(next);
+
+        //number free unknowns
+        int nfree=0;
+        for(int i=0; i<n; i++) fid[i] = (state[i]==FREE) ? nfree++ : -1;
+
+        //free system, active unknowns sit on their bound and enter the right hand side
+        trips.clear();
+        Eigen::VectorXd b = Eigen::VectorXd::Zero(nfree);
+        for(int j=0; j<n; j++){
+            double bj = (state[j]==LOWER) ? lb[j] : ub[j];
+            for(int p=outer[j]; p<outer[j+1]; p++){
+                int i = inner[p];
+                if(fid[i]<0) continue;
+                if(fid[j]>=0){
+                    trips.push_back(Eigen::Triplet<double>(fid[i], fid[j], aval[p]+((i==j) ? ACTIVE_SET_EPS : 0.0)));
+                }
+                else{
+                    b[fid[i]] -= aval[p]*bj;
+                }
+            }
+        }
+        M.resize(nfree, nfree);
+        M.setFromTriplets(trips.begin(), trips.end());
+        M.makeCompressed();
+
+        Eigen::VectorXd y;
+        if(nfree>0){
+            size_t k = getPatternKey(M);
+            if(!ldlt || k!=key){
+                //symbolic factorization only depends on the free pattern
+                ldlt.reset(new Eigen::SimplicialLDLT<SparseMatrixD>());
+                ldlt->analyzePattern(M);
+                key = k;
+            }
+            ldlt->factorize(M);
+            if(ldlt->info()!=Eigen::Success){
+                cerr<<"active set factorization failed"<<endl;
+                return ACTIVE_SET_FAILED;
+            }
+            y = ldlt->solve(b);
+        }
+
+        for(int i=0; i<n; i++){
+            if(state[i]==LOWER) xd[i] = lb[i];
+            else if(state[i]==UPPER) xd[i] = ub[i];
+            else xd[i] = y[fid[i]];
+        }
+        lambda = A*xd;
+        for(int i=0; i<n; i++) if(state[i]==FREE) lambda[i]=0;
+    }
+
+    for(int i=0; i<n; i++){
+        float v = xd[i];
+        if(v<lb[i]) v=lb[i];
+        if(v>ub[i]) v=ub[i];
+        x[i] = v;
+    }
+
+    if(it==maxIter){
+        cout<<"active set did not settle after "<<it<<" iterations"<<endl;
+        return -it;
+    }
+    cout<<"active set settled after "<<it<<" iterations"<<endl;
+    return it;
+}
+
+//drop the cached factorization
+void ActiveSetSolver::release(){
+    ldlt.reset();
+    A = SparseMatrixD();
+    M = SparseMatrixD();
+    key=0;
+}
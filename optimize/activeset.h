@@ -0,0 +1,52 @@
+#ifndef ACTIVESET_H
+#define ACTIVESET_H
+
+#include <Eigen/Sparse>
+#include <Eigen/SparseCholesky>
+
+#include <boost/shared_ptr.hpp>
+
+#include <climits>
+
+#include "csr.h"
+
+using namespace std;
+
+//largest number of active set updates of a direct solve
+const int ACTIVE_SET_MAX_ITER = 100;
+//regularization added to the diagonal of free unknowns, H'H is only semidefinite
+const double ACTIVE_SET_EPS = 1e-8;
+//returned by solve when a factorization fails, x is left unchanged
+const int ACTIVE_SET_FAILED = INT_MIN;
+
+typedef Eigen::SparseMatrix<double> SparseMatrixD;
+
+//direct solver for min 1/2 x'(R+D)x subject to lb <= x <= ub
+//primal-dual active set iteration: unknowns are fixed at a bound while their
+//multiplier pushes against it, the free unknowns are solved exactly with a sparse LDLT.
+//the symbolic factorization is cached by the pattern of the free system, so it is
+//reused whenever the same free set comes back, within a solve or on the next call
+class ActiveSetSolver{
+private:
+    boost::shared_ptr<Eigen::SimplicialLDLT<SparseMatrixD> > ldlt;
+    //R+D with explicit diagonal
+    SparseMatrixD A;
+    //system of the free unknowns
+    SparseMatrixD M;
+    //hash of the pattern the symbolic factorization was computed for, 0 if none
+    size_t key;
+
+public:
+    ActiveSetSolver();
+
+    //solve from x, R without diagonal and D given by its inverse invdg
+    //returns number of active set iterations, minus maxIter when the sets did not settle and
+    //ACTIVE_SET_FAILED when a factorization failed
+    int solve(SparseMatrixPtr R, const vector<float>& invdg, const vector<float>& lb,
+        const vector<float>& ub, vector<float>& x, int maxIter=ACTIVE_SET_MAX_ITER);
+
+    //drop the cached factorization
+    void release();
+};
+
+#endif
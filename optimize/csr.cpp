@@ -0,0 +1,26 @@
+
+#include "csr.h"
+
+using namespace std;
+
+//convert compressed rows to eigen sparse matrix
+SparseMatrixPtr csrToSparse(csr_matPtr A){
+    //compressed rows are the compressed columns of the transpose
+    Eigen::Map<const Eigen::SparseMatrix<float, Eigen::RowMajor> > rowMajor
+        (A->rows, A->cols, A->pr.size(), &(A->jc[0]), A->ir.empty() ? NULL : &(A->ir[0]), A->pr.empty() ? NULL : &(A->pr[0]));
+    SparseMatrixPtr out (new Eigen::SparseMatrix<float>(rowMajor));
+    return out;
+}
+
+//convert eigen sparse matrix to compressed rows
+csr_matPtr sparseToCsr(SparseMatrixPtr A){
+    Eigen::SparseMatrix<float, Eigen::RowMajor> rowMajor (*A);
+    rowMajor.makeCompressed();
+    csr_matPtr out (new csr_mat());
+    out->rows = rowMajor.rows();
+    out->cols = rowMajor.cols();
+    out->jc.assign(rowMajor.outerIndexPtr(), rowMajor.outerIndexPtr()+out->rows+1);
+    out->ir.assign(rowMajor.innerIndexPtr(), rowMajor.innerIndexPtr()+rowMajor.nonZeros());
+    out->pr.assign(rowMajor.valuePtr(), rowMajor.valuePtr()+rowMajor.nonZeros());
+    return out;
+}
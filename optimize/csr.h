@@ -0,0 +1,34 @@
+#ifndef CSR_H
+#define CSR_H
+
+#include <Eigen/Eigen>
+#include <Eigen/Sparse>
+
+#include <boost/shared_ptr.hpp>
+#include <vector>
+
+using namespace std;
+
+typedef boost::shared_ptr<Eigen::SparseMatrix<float> > SparseMatrixPtr;
+
+//compressed sparse row matrix
+//column indices are sorted within each row
+struct csr_mat{
+    int rows;
+    int cols;
+    //row pointers, size rows+1
+    vector<int> jc;
+    //column indices
+    vector<int> ir;
+    //values
+    vector<float> pr;
+};
+typedef boost::shared_ptr<csr_mat> csr_matPtr;
+
+//convert compressed rows to eigen sparse matrix
+SparseMatrixPtr csrToSparse(csr_matPtr A);
+
+//convert eigen sparse matrix to compressed rows
+csr_matPtr sparseToCsr(SparseMatrixPtr A);
+
+#endif
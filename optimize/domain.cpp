@@ -0,0 +1,180 @@
+
+#include "domain.h"
+#include "sweep.h"
+#include <iostream>
+#include <map>
+#include <algorithm>
+
+using namespace std;
+
+//build local rows of slab p
+//part and local give the slab and local position of every owned unknown
+void buildSubdomain(int p, const csr_mat& R, const vector<int>& part, const vector<int>& local,
+    const vector<float>& invdg, const vector<float>& lb, const vector<float>& ub, band_domains& D)
+{
+    band_subdomain& S = D.parts[p];
+    //halo unknowns get local positions after the owned ones
+    map<int,int> halo;
+    S.R.rows = S.nowned;
+    S.R.jc.push_back(0);
+    for(int l=0; l<S.nowned; l++){
+        int row = S.rows[l];
+        for(int i=R.jc[row]; i<R.jc[row+1]; i++){
+            int col = R.ir[i];
+            int lc;
+            if(part[col]==p){
+                lc = local[col];
+            }
+            else{
+                map<int,int>::iterator h = halo.find(col);
+                if(h==halo.end()){
+                    lc = S.rows.size();
+                    halo[col] = lc;
+                    S.rows.push_back(col);
+                    S.halo_part.push_back(part[col]);
+                    S.halo_pos.push_back(local[col]);
+                }
+                else{
+                    lc = h->second;
+                }
+            }
+            S.R.ir.push_back(lc);
+            S.R.pr.push_back(R.pr[i]);
+        }
+        S.R.jc.push_back(S.R.ir.size());
+        S.invdg.push_back(invdg[row]);
+        S.lb.push_back(lb[row]);
+        S.ub.push_back(ub[row]);
+    }
+    S.R.cols = S.rows.size();
+}
+
+//build slabs [begin,end)
+void buildSubdomainRange(int begin, int end, const csr_mat& R, const vector<int>& part, const vector<int>& local,
+    const vector<float>& invdg, const vector<float>& lb, const vector<float>& ub, band_domains& D)
+{
+    for(int p=begin; p<end; p++){
+        buildSubdomain(p, R, part, local, invdg, lb, ub, D);
+    }
+}
+
+//split unknowns into nparts z slabs with balanced unknown counts
+band_domainsPtr getDomains(const csr_mat& R, const vector<int>& indexes, const Eigen::Vector3i& dims,
+    const vector<float>& invdg, const vector<float>& lb, const vector<float>& ub, int nparts)
+{
+    int nband = indexes.size();
+    int slice = dims[0]*dims[1];
+
+    //unknowns below each z plane
+    vector<int> below (dims[2]+1, 0);
+    for(int i=0; i<nband; i++) below[indexes[i]/slice+1]++;
+    for(int z=0; z<dims[2]; z++) below[z+1] += below[z];
+
+    //first z plane of each slab, planes are never split
+    vector<int> first (nparts+1, dims[2]);
+    first[0]=0;
+    int z=0;
+    for(int p=1; p<nparts; p++){
+        long target = ((long)nband*p)/nparts;
+        while(z<dims[2] && below[z]<target) z++;
+        first[p]=z;
+    }
+
+    band_domainsPtr D (new band_domains());
+    D->rows = nband;
+    D->parts.resize(nparts);
+    vector<int> part (nband);
+    vector<int> local (nband);
+    for(int i=0; i<nband; i++){
+        int p = upper_bound(first.begin(), first.end()-1, indexes[i]/slice)-first.begin()-1;
+        part[i] = p;
+        local[i] = D->parts[p].rows.size();
+        D->parts[p].rows.push_back(i);
+    }
+    for(int p=0; p<nparts; p++) D->parts[p].nowned = D->parts[p].rows.size();
+
+    //each slab is built by one thread
+    parallelFor(nparts, boost::bind(buildSubdomainRange, _1, _2, boost::cref(R), boost::cref(part),
+        boost::cref(local), boost::cref(invdg), boost::cref(lb), boost::cref(ub), boost::ref(*D)), nparts);
+
+    int nhalo=0;
+    for(int p=0; p<nparts; p++) nhalo += D->parts[p].rows.size()-D->parts[p].nowned;
+    cout<<"band split into "<<nparts<<" slabs with "<<nhalo<<" halo unknowns"<<endl;
+    return D;
+}
+
+//data shared by slab workers
+struct domain_job{
+    const band_domains* D;
+    //two private buffers per slab, local[2*p+b]
+    vector<vector<float> > local;
+    float* bufs[2];
+    int iter;
+    int nworkers;
+    boost::barrier* sync;
+};
+
+//sweep slabs t, t+nworkers, ... and refresh their halos after every sweep
+void domainWorker(int t, domain_job& job){
+    const band_domains& D = *job.D;
+    int nparts = D.parts.size();
+
+    //private buffers are allocated and filled by the thread that sweeps them
+    for(int p=t; p<nparts; p+=job.nworkers){
+        const band_subdomain& S = D.parts[p];
+        job.local[2*p].resize(S.rows.size());
+        job.local[2*p+1].resize(S.rows.size());
+        for(int l=0; l<S.rows.size(); l++) job.local[2*p][l] = job.bufs[0][S.rows[l]];
+    }
+
+    for(int i=0; i<job.iter; i++){
+        int src = i%2;
+        int dst = (i+1)%2;
+        for(int p=t; p<nparts; p+=job.nworkers){
+            const band_subdomain& S = D.parts[p];
+            if(S.nowned==0) continue;
+            sweepRows(0, S.nowned, &job.local[2*p+src][0], &job.local[2*p+dst][0],
+                &S.R.jc[0], S.R.ir.empty() ? NULL : &S.R.ir[0], S.R.pr.empty() ? NULL : &S.R.pr[0], NULL,
+                &S.invdg[0], &S.lb[0], &S.ub[0]);
+        }
+        //owned rows of every slab must be written before halos are copied
+        //owners write the other buffer next sweep, so one barrier per sweep is enough
+        job.sync->wait();
+        for(int p=t; p<nparts; p+=job.nworkers){
+            const band_subdomain& S = D.parts[p];
+            if(S.halo_part.empty()) continue;
+            float* out = &job.local[2*p+dst][0];
+            for(int h=0; h<S.halo_part.size(); h++){
+                out[S.nowned+h] = job.local[2*S.halo_part[h]+dst][S.halo_pos[h]];
+            }
+        }
+    }
+
+    //write back the last two iterates
+    for(int p=t; p<nparts; p+=job.nworkers){
+        const band_subdomain& S = D.parts[p];
+        for(int l=0; l<S.nowned; l++){
+            job.bufs[0][S.rows[l]] = job.local[2*p][l];
+            job.bufs[1][S.rows[l]] = job.local[2*p+1][l];
+        }
+    }
+}
+
+//run iter jacobi sweeps starting at bufs[0] on private slab buffers
+int runDomainSweeps(const band_domains& D, float* bufs[2], int iter, sweep_pool& pool){
+    if(D.rows==0 || iter==0) return 0;
+
+    boost::barrier sync (pool.size());
+    domain_job job;
+    job.D = &D;
+    job.local.resize(2*D.parts.size());
+    job.bufs[0] = bufs[0];
+    job.bufs[1] = bufs[1];
+    job.iter = iter;
+    job.nworkers = pool.size();
+    job.sync = &sync;
+
+    pool.run(boost::bind(domainWorker, _1, boost::ref(job)));
+
+    return iter % 2;
+}
@@ -0,0 +1,45 @@
+#ifndef DOMAIN_H
+#define DOMAIN_H
+
+#include <Eigen/Eigen>
+
+#include "csr.h"
+#include "parallel.h"
+
+using namespace std;
+
+//one z slab of band unknowns with private copies of everything its sweeps touch
+//local unknowns are the owned rows followed by the halo, the rows of other slabs
+//that owned rows depend on
+struct band_subdomain{
+    //global unknowns, owned rows first
+    vector<int> rows;
+    int nowned;
+    //rows of R for owned unknowns in local columns
+    csr_mat R;
+    vector<float> invdg;
+    vector<float> lb;
+    vector<float> ub;
+    //owner slab and local position of each halo unknown
+    vector<int> halo_part;
+    vector<int> halo_pos;
+};
+
+//band unknowns split into z slabs
+struct band_domains{
+    int rows;
+    vector<band_subdomain> parts;
+};
+typedef boost::shared_ptr<band_domains> band_domainsPtr;
+
+//split unknowns into nparts z slabs with balanced unknown counts
+//indexes gives the linear voxel index of each unknown in a grid of size dims
+band_domainsPtr getDomains(const csr_mat& R, const vector<int>& indexes, const Eigen::Vector3i& dims,
+    const vector<float>& invdg, const vector<float>& lb, const vector<float>& ub, int nparts);
+
+//run iter jacobi sweeps starting at bufs[0], each slab is swept on its own worker
+//from private buffers, halo values are copied from their owners between sweeps.
+//the last two iterates are written back to bufs, returns index of the buffer holding the result
+int runDomainSweeps(const band_domains& D, float* bufs[2], int iter, sweep_pool& pool);
+
+#endif
@@ -0,0 +1,138 @@
+
+#include "packed.h"
+#include "sweep.h"
+#include <iostream>
+#include <algorithm>
+
+using namespace std;
+
+//pack compressed rows, returns empty pointer when a value is not an exact int8
+packed_matPtr getPacked(const csr_mat& R){
+    packed_matPtr A (new packed_mat());
+    A->rows = R.rows;
+    A->jc.reserve(R.rows+1);
+    A->off.reserve(R.ir.size());
+    A->coef.reserve(R.ir.size());
+    A->jc.push_back(0);
+    A->wide_jc.push_back(0);
+
+    for(int row=0; row<R.rows; row++){
+        bool wide=false;
+        for(int i=R.jc[row]; i<R.jc[row+1]; i++){
+            float v = R.pr[i];
+            if(v!=floor(v) || v<-128.0 || v>127.0){
+                cout<<"R has non-integer entries, not packing"<<endl;
+                return packed_matPtr();
+            }
+            int off = R.ir[i]-row;
+            if(off<-32768 || off>32767) wide=true;
+        }
+
+        if(wide){
+            A->wide_rows.push_back(row);
+            for(int i=R.jc[row]; i<R.jc[row+1]; i++){
+                A->wide_ir.push_back(R.ir[i]);
+                A->wide_pr.push_back(R.pr[i]);
+            }
+            A->wide_jc.push_back(A->wide_ir.size());
+        }
+        else{
+            for(int i=R.jc[row]; i<R.jc[row+1]; i++){
+                A->off.push_back((short)(R.ir[i]-row));
+                A->coef.push_back((signed char)R.pr[i]);
+            }
+        }
+        A->jc.push_back(A->off.size());
+    }
+
+    cout<<"packed R, "<<A->wide_rows.size()<<" of "<<R.rows<<" rows kept wide"<<endl;
+    return A;
+}
+
+//jacobi update of rows [begin,end) from in to out, accumulated in fp32
+//out = clamp((in-R*in*invdg)/2, lb, ub)
+void packedSweepRows(const packed_mat& A, int begin, int end, const float* __restrict__ in, float* __restrict__ out,
+    const float* __restrict__ invdg, const float* __restrict__ lb, const float* __restrict__ ub)
+{
+    const int* jc = &A.jc[0];
+    const short* off = A.off.empty() ? NULL : &A.off[0];
+    const signed char* coef = A.coef.empty() ? NULL : &A.coef[0];
+    for(int row=begin; row<end; row++){
+        const float* base = in+row;
+        float res0 = 0;
+        float res1 = 0;
+        int i = jc[row];
+        int stop = jc[row+1];
+        for(; i+1<stop; i+=2){
+            res0 += (float)coef[i]*base[off[i]];
+            res1 += (float)coef[i+1]*base[off[i+1]];
+        }
+        if(i<stop) res0 += (float)coef[i]*base[off[i]];
+
+        float res = (in[row]-(res0+res1)*invdg[row])*0.5f;
+        res = max(res, lb[row]);
+        res = min(res, ub[row]);
+        out[row] = res;
+    }
+
+    //wide rows of the block were written from empty packed rows above, redo them in fp32
+    vector<int>::const_iterator w = lower_bound(A.wide_rows.begin(), A.wide_rows.end(), begin);
+    for(; w!=A.wide_rows.end() && *w<end; w++){
+        int k = w-A.wide_rows.begin();
+        int row = *w;
+        float res = 0;
+        for(int i=A.wide_jc[k]; i<A.wide_jc[k+1]; i++)
+            res += A.wide_pr[i]*in[A.wide_ir[i]];
+
+        res = (in[row]-res*invdg[row])*0.5f;
+        res = max(res, lb[row]);
+        res = min(res, ub[row]);
+        out[row] = res;
+    }
+}
+
+//data shared by packed sweep workers
+struct packed_job{
+    const packed_mat* A;
+    const float* invdg;
+    const float* lb;
+    const float* ub;
+    float* bufs[2];
+    vector<int> blocks;
+    int iter;
+    boost::barrier* sync;
+};
+
+//sweep the row block of worker t for every iteration
+void packedWorker(int t, packed_job& job){
+    for(int i=0; i<job.iter; i++){
+        packedSweepRows(*job.A, job.blocks[t], job.blocks[t+1], job.bufs[i%2], job.bufs[(i+1)%2],
+            job.invdg, job.lb, job.ub);
+        job.sync->wait();
+    }
+}
+
+//run iter jacobi sweeps starting at bufs[0], row blocks are swept in parallel on the pool
+//returns index of the buffer holding the result
+int runPackedSweeps(const packed_mat& A, float* bufs[2], const vector<float>& invdg,
+    const vector<float>& lb, const vector<float>& ub, int iter, sweep_pool& pool)
+{
+    if(A.rows==0) return 0;
+
+    boost::barrier sync (pool.size());
+    packed_job job;
+    job.A = &A;
+    job.invdg = &invdg[0];
+    job.lb = &lb[0];
+    job.ub = &ub[0];
+    job.bufs[0] = bufs[0];
+    job.bufs[1] = bufs[1];
+    //row blocks with balanced nonzeros
+    job.blocks = getBlocks(A.jc, A.rows, pool.size());
+    job.iter = iter;
+    job.sync = &sync;
+
+    pool.run(boost::bind(packedWorker, _1, boost::ref(job)));
+
+    return iter % 2;
+}
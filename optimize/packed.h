@@ -0,0 +1,41 @@
+#ifndef PACKED_H
+#define PACKED_H
+
+#include "csr.h"
+#include "parallel.h"
+
+using namespace std;
+
+//reduced precision storage of R
+//entries of H'H are small integers, so each coefficient is stored exactly as an int8 and
+//each column as an int16 offset from its row: 3 bytes per nonzero instead of 8.
+//rows with an offset that does not fit in an int16 are kept as wide fp32 rows
+struct packed_mat{
+    int rows;
+    //row pointers into off/coef, size rows+1, wide rows are empty here
+    vector<int> jc;
+    //column minus row
+    vector<short> off;
+    vector<signed char> coef;
+    //sorted wide rows and their compressed entries
+    vector<int> wide_rows;
+    vector<int> wide_jc;
+    vector<int> wide_ir;
+    vector<float> wide_pr;
+};
+typedef boost::shared_ptr<packed_mat> packed_matPtr;
+
+//pack compressed rows, returns empty pointer when a value is not an exact int8
+packed_matPtr getPacked(const csr_mat& R);
+
+//jacobi update of rows [begin,end) from in to out, accumulated in fp32
+//out = clamp((in-R*in*invdg)/2, lb, ub)
+void packedSweepRows(const packed_mat& A, int begin, int end, const float* in, float* out,
+    const float* invdg, const float* lb, const float* ub);
+
+//run iter jacobi sweeps starting at bufs[0], row blocks are swept in parallel on the pool
+//returns index of the buffer holding the result
+int runPackedSweeps(const packed_mat& A, float* bufs[2], const vector<float>& invdg,
+    const vector<float>& lb, const vector<float>& ub, int iter, sweep_pool& pool);
+
+#endif
@@ -0,0 +1,65 @@
+
+#include "parallel.h"
+
+using namespace std;
+
+//get number of worker threads, 0 uses all hardware threads
+int getNumThreads(int nthreads){
+    if(nthreads>0) return nthreads;
+    int hw = boost::thread::hardware_concurrency();
+    if(hw<1) hw=1;
+    return hw;
+}
+
+//split [0,n) into contiguous blocks and run f(begin,end) on each block in its own thread
+void parallelFor(int n, boost::function<void(int,int)> f, int nthreads){
+    nthreads = getNumThreads(nthreads);
+    if(nthreads>n) nthreads=n;
+    if(nthreads<=1){
+        if(n>0) f(0, n);
+        return;
+    }
+    boost::thread_group workers;
+    int block = (n+nthreads-1)/nthreads;
+    for(int t=0; t<nthreads; t++){
+        int begin = t*block;
+        int end = min(n, begin+block);
+        if(begin>=end) break;
+        workers.create_thread(boost::bind(f, begin, end));
+    }
+    workers.join_all();
+}
+
+sweep_pool::sweep_pool(int nthreads_in):
+    nthreads(getNumThreads(nthreads_in)), start(nthreads+1), finish(nthreads+1), stopping(false)
+{
+    for(int t=0; t<nthreads; t++){
+        workers.create_thread(boost::bind(&sweep_pool::work, this, t));
+    }
+}
+
+sweep_pool::~sweep_pool(){
+    stopping=true;
+    start.wait();
+    workers.join_all();
+}
+
+void sweep_pool::work(int t){
+    while(true){
+        start.wait();
+        if(stopping) return;
+        job(t);
+        finish.wait();
+    }
+}
+
+int sweep_pool::size() const{
+    return nthreads;
+}
+
+void sweep_pool::run(boost::function<void(int)> job_in){
+    job = job_in;
+    start.wait();
+    finish.wait();
+    job.clear();
+}
@@ -0,0 +1,40 @@
+#ifndef PARALLEL_H
+#define PARALLEL_H
+
+#include <boost/thread/thread.hpp>
+#include <boost/thread/barrier.hpp>
+#include <boost/function.hpp>
+#include <boost/bind/bind.hpp>
+
+using namespace std;
+using namespace boost::placeholders;
+
+//get number of worker threads, 0 uses all hardware threads
+int getNumThreads(int nthreads);
+
+//split [0,n) into contiguous blocks and run f(begin,end) on each block in its own thread
+void parallelFor(int n, boost::function<void(int,int)> f, int nthreads=0);
+
+//persistent worker threads
+//each call to run executes job(t) on every worker t and returns when all are done
+class sweep_pool{
+private:
+    int nthreads;
+    boost::thread_group workers;
+    boost::barrier start;
+    boost::barrier finish;
+    boost::function<void(int)> job;
+    bool stopping;
+
+    void work(int t);
+
+public:
+    //0 threads uses all hardware threads
+    sweep_pool(int nthreads_in=0);
+    ~sweep_pool();
+
+    int size() const;
+    void run(boost::function<void(int)> job_in);
+};
+
+#endif
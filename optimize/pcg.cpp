@@ -0,0 +1,152 @@
+
+#include "pcg.h"
+#include "sweep.h"
+
+#include <math.h>
+
+using namespace std;
+
+//stages of a conjugate gradient iteration run by the workers
+enum pcg_stage{
+    //r = b-A*x, s = r/diag, sums r.s and r.r
+    PCG_RESIDUAL,
+    //q = A*p, sum p.q
+    PCG_APPLY,
+    //x += alpha*p, r -= alpha*q, s = r/diag, sums r.s and r.r
+    PCG_UPDATE,
+    //p = s+beta*p
+    PCG_DIRECTION
+};
+
+//data shared by conjugate gradient workers
+struct pcg_job{
+    const csr_mat* A;
+    const float* b;
+    const float* dinv;
+    float* x;
+    float* r;
+    float* s;
+    float* p;
+    float* q;
+    float alpha;
+    float beta;
+    pcg_stage stage;
+    vector<int> blocks;
+    //partial sums of each worker
+    vector<double> sum1;
+    vector<double> sum2;
+};
+
+//run the current stage on the row block of worker t
+void pcgWorker(int t, pcg_job& job){
+    const csr_mat& A = *job.A;
+    const int* ir = A.ir.empty() ? NULL : &A.ir[0];
+    const float* pr = A.pr.empty() ? NULL : &A.pr[0];
+    int begin = job.blocks[t];
+    int end = job.blocks[t+1];
+    double sum1 = 0;
+    double sum2 = 0;
+
+    if(job.stage==PCG_RESIDUAL){
+        spmvRows(begin, end, job.x, job.r, &A.jc[0], ir, pr, job.b, -1.0f);
+        for(int i=begin; i<end; i++){
+            job.s[i] = job.r[i]*job.dinv[i];
+            sum1 += job.r[i]*job.s[i];
+            sum2 += job.r[i]*job.r[i];
+        }
+    }
+    else if(job.stage==PCG_APPLY){
+        spmvRows(begin, end, job.p, job.q, &A.jc[0], ir, pr, NULL, 1.0f);
+        for(int i=begin; i<end; i++){
+            sum1 += job.p[i]*job.q[i];
+        }
+    }
+    else if(job.stage==PCG_UPDATE){
+        for(int i=begin; i<end; i++){
+            job.x[i] += job.alpha*job.p[i];
+            job.r[i] -= job.alpha*job.q[i];
+            job.s[i] = job.r[i]*job.dinv[i];
+            sum1 += job.r[i]*job.s[i];
+            sum2 += job.r[i]*job.r[i];
+        }
+    }
+    else{
+        for(int i=begin; i<end; i++){
+            job.p[i] = job.s[i]+job.beta*job.p[i];
+        }
+    }
+    job.sum1[t] = sum1;
+    job.sum2[t] = sum2;
+}
+
+//run one stage on all workers, returns the totals of the partial sums in sum1 and sum2
+void runPCGStage(pcg_job& job, pcg_stage stage, sweep_pool& pool, double& sum1, double& sum2){
+    job.stage = stage;
+    pool.run(boost::bind(pcgWorker, _1, boost::ref(job)));
+    sum1 = 0;
+    sum2 = 0;
+    for(int t=0; t<job.sum1.size(); t++){
+        sum1 += job.sum1[t];
+        sum2 += job.sum2[t];
+    }
+}
+
+//jacobi preconditioned conjugate gradients for symmetric positive definite A
+int runPCG(const csr_mat& A, const vector<float>& b, vector<float>& x, float tol,
+    int maxIter, sweep_pool& pool)
+{
+    int n = A.rows;
+    x.resize(n, 0.0f);
+    if(n==0) return 0;
+
+    //inverse diagonal, rows without a positive diagonal are left unscaled
+    vector<float> dinv (n, 1.0f);
+    for(int row=0; row<n; row++){
+        for(int i=A.jc[row]; i<A.jc[row+1]; i++){
+            if(A.ir[i]==row && A.pr[i]>0) dinv[row] = 1.0f/A.pr[i];
+        }
+    }
+    double bnorm = 0;
+    for(int i=0; i<n; i++) bnorm += b[i]*b[i];
+    bnorm = sqrt(bnorm);
+
+    vector<float> r (n);
+    vector<float> s (n);
+    vector<float> p (n);
+    vector<float> q (n);
+    pcg_job job;
+    job.A = &A;
+    job.b = &b[0];
+    job.dinv = &dinv[0];
+    job.x = &x[0];
+    job.r = &r[0];
+    job.s = &s[0];
+    job.p = &p[0];
+    job.q = &q[0];
+    job.alpha = 0;
+    job.beta = 0;
+    job.blocks = getRowBlocks(A, pool.size());
+    job.sum1.assign(pool.size(), 0);
+    job.sum2.assign(pool.size(), 0);
+
+    double rs, rr, pq, unused;
+    runPCGStage(job, PCG_RESIDUAL, pool, rs, rr);
+    if(sqrt(rr)<=tol*bnorm) return 0;
+    //first direction is the preconditioned residual
+    copy(s.begin(), s.end(), p.begin());
+
+    for(int k=1; k<=maxIter; k++){
+        runPCGStage(job, PCG_APPLY, pool, pq, unused);
+        if(!(pq>0)) return -1;
+        job.alpha = rs/pq;
+
+        double rsNext;
+        runPCGStage(job, PCG_UPDATE, pool, rsNext, rr);
+        if(sqrt(rr)<=tol*bnorm) return k;
+
+        job.beta = rsNext/rs;
+        rs = rsNext;
+        runPCGStage(job, PCG_DIRECTION, pool, unused, unused);
+    }
+    return maxIter;
+}
@@ -0,0 +1,20 @@
+#ifndef PCG_H
+#define PCG_H
+
+#include "csr.h"
+#include "parallel.h"
+
+using namespace std;
+
+//largest number of conjugate gradient iterations of a solve
+const int PCG_MAX_ITER = 1000;
+
+//solve A*x = b for symmetric positive definite A with jacobi preconditioned conjugate gradients.
+//x holds the starting guess on entry and the solution on return. rows are split into
+//one block per worker of the pool, the product and vector updates of a block are fused.
+//stops once |b-A*x| <= tol*|b|. returns the number of iterations, maxIter when tol
+//was not reached, -1 when A is not positive definite along a search direction
+int runPCG(const csr_mat& A, const vector<float>& b, vector<float>& x, float tol,
+    int maxIter, sweep_pool& pool);
+
+#endif
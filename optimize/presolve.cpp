@@ -0,0 +1,59 @@
+
+#include "presolve.h"
+#include <iostream>
+
+using namespace std;
+
+//pin unknowns held at a bound and reduce R to the remaining unknowns
+qp_presolvePtr getPresolve(const csr_mat& R, const vector<float>& x,
+    const vector<float>& invdg, const vector<float>& lb, const vector<float>& ub)
+{
+    int n = R.rows;
+    qp_presolvePtr P (new qp_presolve());
+
+    //local position of free unknowns, -1 for pinned
+    vector<int> pos (n, -1);
+    for(int row=0; row<n; row++){
+        bool pinned = (lb[row]==ub[row]);
+        if(!pinned && (x[row]==lb[row] || x[row]==ub[row])){
+            //unclamped update from x
+            float res = 0;
+            for(int i=R.jc[row]; i<R.jc[row+1]; i++)
+                res += R.pr[i]*x[R.ir[i]];
+            res = (x[row]-res*invdg[row])*0.5f;
+            pinned = (x[row]==lb[row] && res<lb[row]) || (x[row]==ub[row] && res>ub[row]);
+        }
+        if(!pinned){
+            pos[row] = P->free_.size();
+            P->free_.push_back(row);
+        }
+    }
+
+    //free rows, pinned columns go to b
+    int nfree = P->free_.size();
+    P->R.rows = nfree;
+    P->R.cols = nfree;
+    P->R.jc.reserve(nfree+1);
+    P->R.jc.push_back(0);
+    P->b.assign(nfree, 0);
+    for(int k=0; k<nfree; k++){
+        int row = P->free_[k];
+        for(int i=R.jc[row]; i<R.jc[row+1]; i++){
+            int col = R.ir[i];
+            if(pos[col]>=0){
+                P->R.ir.push_back(pos[col]);
+                P->R.pr.push_back(R.pr[i]);
+            }
+            else{
+                P->b[k] += R.pr[i]*x[col];
+            }
+        }
+        P->R.jc.push_back(P->R.ir.size());
+        P->invdg.push_back(invdg[row]);
+        P->lb.push_back(lb[row]);
+        P->ub.push_back(ub[row]);
+    }
+
+    cout<<"presolve pinned "<<n-nfree<<" of "<<n<<" unknowns"<<endl;
+    return P;
+}
@@ -0,0 +1,29 @@
+#ifndef PRESOLVE_H
+#define PRESOLVE_H
+
+#include "csr.h"
+
+using namespace std;
+
+//system left after pinning unknowns at their bounds
+//free rows keep their entries between free unknowns, entries of pinned
+//unknowns are folded into the constant b, so R*x becomes R_ff*x_f + b
+struct qp_presolve{
+    //free unknowns in the original numbering
+    vector<int> free_;
+    //rows of R between free unknowns
+    csr_mat R;
+    //contribution of pinned unknowns to each free row
+    vector<float> b;
+    vector<float> invdg;
+    vector<float> lb;
+    vector<float> ub;
+};
+typedef boost::shared_ptr<qp_presolve> qp_presolvePtr;
+
+//pin unknowns whose bounds coincide, or that sit on a bound of x and would be pushed
+//past it by the next sweep, then reduce R to the remaining unknowns
+qp_presolvePtr getPresolve(const csr_mat& R, const vector<float>& x,
+    const vector<float>& invdg, const vector<float>& lb, const vector<float>& ub);
+
+#endif
@@ -4,111 +4,49 @@
 using namespace std;
 
 //make H matrix
+//returns H'H for the band unknowns of indexMap
 SparseMatrixPtr getHMat(gridPtr tightBand, gridPtr indexMap){
-    vector<int> indexes = findIndexes(tightBand);
-    //set ntight
-    int ntight = indexes.size();
-
-    //get subscript vector for indexes
-    Eigen::Vector3i subs[ntight];
-    for(int i=0; i<ntight; i++){
-        subs[i] = tightBand->ind2sub(indexes[i]);
-    }
-
-    //create Hi
-    vector<int> Hi (ntight*9, 0);
-    int index=0;
-    for(int i=0; i<3; i++){
-        for(int j=0; j<3; j++){
-            for(int k=0; k<ntight; k++){
-                Hi[index] = k+ntight*i;
-                index++;
+    //recover band indexes from index map
+    vector<float> map_ = flattenGrid(indexMap);
+    int nband=0;
+    for(int i=0; i<map_.size(); i++){
+        if(map_[i]>=0.0) nband++;
+    }
+    vector<int> indexes (nband, 0);
+    for(int i=0; i<map_.size(); i++){
+        if(map_[i]>=0.0) indexes[(int)map_[i]] = i;
+    }
+
+    //off-diagonal entries and diagonal
+    vector<float> dg;
+    csr_matPtr R = getHCsr(tightBand, indexMap, indexes, dg);
+
+    //merge diagonal into sorted rows
+    csr_matPtr H (new csr_mat());
+    H->rows = R->rows;
+    H->cols = R->cols;
+    H->jc.resize(nband+1, 0);
+    H->ir.reserve(R->ir.size()+nband);
+    H->pr.reserve(R->pr.size()+nband);
+    for(int r=0; r<nband; r++){
+        bool placed = (dg[r]==0.0);
+        for(int i=R->jc[r]; i<R->jc[r+1]; i++){
+            if(!placed && R->ir[i]>r){
+                H->ir.push_back(r);
+                H->pr.push_back(dg[r]);
+                placed=true;
             }
+            H->ir.push_back(R->ir[i]);
+            H->pr.push_back(R->pr[i]);
         }
-    }
-
-    //create Hj
-    vector<int> Hj (ntight*9, 0);
-    index=0;
-    //add mid
-    for(int i=0; i<ntight; i++){
-        Hj[index] = (*indexMap)[subs[i][0]][subs[i][1]][subs[i][2]];
-        index++;
-    }
-    //add left
-    for(int i=0; i<ntight; i++){
-        Hj[index] = (*indexMap)[subs[i][0]-1][subs[i][1]][subs[i][2]];
-        index++;
-    }
-    //add right
-    for(int i=0; i<ntight; i++){
-        Hj[index] = (*indexMap)[subs[i][0]+1][subs[i][1]][subs[i][2]];
-        index++;
-    }
-    //add mid
-    for(int i=0; i<ntight; i++){
-        Hj[index] = (*indexMap)[subs[i][0]][subs[i][1]][subs[i][2]];
-        index++;
-    }
-    //add top
-    for(int i=0; i<ntight; i++){
-        Hj[index] = (*indexMap)[subs[i][0]][subs[i][1]-1][subs[i][2]];
-        index++;
-    }
-    //add bottom
-    for(int i=0; i<ntight; i++){
-        Hj[index] = (*indexMap)[subs[i][0]][subs[i][1]+1][subs[i][2]];
-        index++;
-    }
-    //add mid
-    for(int i=0; i<ntight; i++){
-        Hj[index] = (*indexMap)[subs[i][0]][subs[i][1]][subs[i][2]];
-        index++;
-    }
-    //add front
-    for(int i=0; i<ntight; i++){
-        Hj[index] = (*indexMap)[subs[i][0]][subs[i][1]][subs[i][2]-1];
-        index++;
-    }
-    //add back
-    for(int i=0; i<ntight; i++){
-        Hj[index] = (*indexMap)[subs[i][0]][subs[i][1]][subs[i][2]+1];
-        index++;
-    }
-
-    //create Hs
-    vector<int> Hs (ntight*9, 1);
-    index=0;
-    for(int i=0; i<3; i++){
-        for(int j=0; j<ntight; j++){
-            Hs[index]=-2;
-            index++;
-        }
-        for(int j=0; j<ntight*2; j++){
-            Hs[index]=1;
-            index++;
+        if(!placed){
+            H->ir.push_back(r);
+            H->pr.push_back(dg[r]);
         }
+        H->jc[r+1] = H->ir.size();
     }
 
-
-    //create initial H
-    //get max value of Hj
-    int maxj = 0;
-    for(int i=0; i<Hj.size(); i++){
-        if (Hj[i]>maxj) maxj=Hj[i];
-    }
-    //create triplets from Hi,Hj,Hs
-    vector<Eigen::Triplet<float> > tripletList;
-    tripletList.reserve(Hi.size());
-    for(int i=0; i<Hi.size(); i++){
-        tripletList.push_back(Eigen::Triplet<float>(Hi[i],Hj[i],(float)Hs[i]));
-    }
-
-    SparseMatrixPtr H (new Eigen::SparseMatrix<float>(3*ntight, maxj+1));
-    H->setFromTriplets(tripletList.begin(), tripletList.end());
-
-    *H = Eigen::SparseMatrix<float>(H->transpose())*(*H);
-    return H;
+    return csrToSparse(H);
 }
 
 //get lower bound vector
@@ -165,63 +103,106 @@ vector<float> getub(gridPtr margin, gridPtr volume, const vector<int> &indexes){
 }
 
 //prepare quadratic program arguments
-qp_argsPtr primeQP(gridPtr volume, gridPtr margin, bandsPtr bnds){
+qp_argsPtr primeQP(gridPtr volume, gridPtr margin, bandsPtr bnds, const bool USING_STENCIL){
     //create indexes of band
     vector<int> indexes = findIndexes(bnds->band);
+    return primeQP(volume, margin, bnds, indexes, USING_STENCIL);
+}
+
+//prepare quadratic program arguments with unknowns numbered in the order of indexes
+qp_argsPtr primeQP(gridPtr volume, gridPtr margin, bandsPtr bnds, const vector<int>& indexes, const bool USING_STENCIL){
     //create index map
     gridPtr indexMap = getIndexMap(bnds->band, indexes);
-    //create H matrix
-    SparseMatrixPtr H = getHMat(bnds->tight_band, indexMap);
-    //H matrix has size nband x nband
+
+    //create output struct
+    qp_argsPtr out (new qp_args());
+
+    if(USING_STENCIL){
+        //apply H'H directly from the band stencil, no sparse assembly
+        out->stencil = getStencil(bnds->tight_band, indexMap, indexes, out->invdg);
+    }
+    else{
+        //create R = H'H - diag(H'H) with the diagonal split out
+        vector<float> dg;
+        csr_matPtr R = getHCsr(bnds->tight_band, indexMap, indexes, dg);
+        //R matrix has size nband x nband
+
+        //get invdg
+        vector<float> invdg_ (dg.size(), 0);
+        for(int i=0; i<dg.size(); i++){
+            if(dg[i]!=0.0) invdg_[i] = 1.0/dg[i];
+        }
+
+        out->R = csrToSparse(R);
+        out->invdg = invdg_;
+    }
+
     //create upper and lower bounds
     vector<float> lb_ = getlb(margin, volume, indexes);
     vector<float> ub_ = getub(margin, volume, indexes);
     //lb_ and ub_ have length nband
 
     //create x vector
-    vector<float> x_ (H->rows(),0);
+    vector<float> x_ (lb_.size(),0);
     for(int i=0; i<x_.size(); i++){
         //set values within upper and lower bounds
         if(x_[i]<lb_[i]) x_[i]=lb_[i];
         if(x_[i]>ub_[i]) x_[i]=ub_[i];
     }
 
-    //get invdg
-    Eigen::SparseVector<float> diag = (H->diagonal()).sparseView();
-    vector<float> dg (diag.size(), 0);
-    vector<float> invdg_ (diag.size(), 0);
-    for (Eigen::SparseVector<float>::InnerIterator it(diag); it; ++it)
-    {
-        dg[it.index()] = (float)it.value();
-        invdg_[it.index()] = 1.0/(float)it.value();
-    }
-
-    //create 0-diagonal matrix
-    vector<Eigen::Triplet<float> > diag_trips;
-    diag_trips.reserve(H->rows());
-    for(int i=0; i<dg.size(); i++){
-        if(dg[i]!=0.0){
-            diag_trips.push_back(Eigen::Triplet<float>(i,i,dg[i]));
-        }
-    }
-    SparseMatrixPtr d (new Eigen::SparseMatrix<float>(H->rows(), H->cols()));
-    d->setFromTriplets(diag_trips.begin(), diag_trips.end());
-    *H = ((*H)-(*d));
-    H->prune(0,0);
-
-    //create output struct
-    qp_argsPtr out (new qp_args());
-    out->R = H;
-    out->invdg = invdg_;
     out->lb = lb_;
     out->ub = ub_;
     out->x = x_;
     out->iter = 500;
+    out->tol = 0;
+    out->deadline = 0;
+    out->direct = false;
+    out->presolve = 0;
+    out->threads = 0;
 
     cout<<"quadratic program ready"<<endl;
     return out;
 }
 
+//seed x from a previous embedding grid aligned to volume by world transform
+//voxels of prevF outside its band hold +-outside and are not used
+int warmStart(gridPtr prevF, gridPtr volume, const vector<int>& indexes, float outside,
+    const vector<float>& lb, const vector<float>& ub, vector<float>& x)
+{
+    vector<float> seeded (x);
+    int count=0;
+    for(int i=0; i<indexes.size(); i++){
+        //world position of unknown
+        Eigen::Vector3i sub = volume->ind2sub(indexes[i]);
+        Eigen::Vector3f p = volume->getCloudPoint(sub.cast<float>());
+
+        //nearest voxel of previous grid
+        Eigen::Vector3i q;
+        bool inside=true;
+        for(int a=0; a<3; a++){
+            q[a] = (int)floor((p[a]-prevF->shift[a])/prevF->scale[a]+(float)prevF->pad+0.5);
+            if(q[a]<0 || q[a]>=prevF->dims[a]) inside=false;
+        }
+        if(!inside) continue;
+
+        float v = (*prevF)[q[0]][q[1]][q[2]];
+        if(fabs(v)>=outside) continue;
+
+        if(v<lb[i]) v=lb[i];
+        if(v>ub[i]) v=ub[i];
+        seeded[i]=v;
+        count++;
+    }
+
+    if(2*count<(int)x.size()){
+        cout<<"previous embedding overlaps "<<count<<" of "<<x.size()<<" unknowns, using cold start"<<endl;
+        return 0;
+    }
+    x.swap(seeded);
+    cout<<"warm started "<<count<<" of "<<x.size()<<" unknowns"<<endl;
+    return count;
+}
+
 //************************************************************************************
 //get feature index vector from feature map and index map
 //sorted low to high
@@ -242,3 +223,14 @@ vector<int> getFeatureIndexes(gridPtr featureMap, gridPtr indexMap){
     sort(out.begin(), out.end(), lowtohigh);
     return out;
 }
+
+//reset solution at sorted feature indexes
+void setFeatureValues(vector<float>& x, const vector<int>& featureIndexes){
+    int count=0;
+    for(int i=0; i<x.size() && count<featureIndexes.size(); i++){
+        if(i==featureIndexes[count]){
+            x[i]=0.2; //<--------------------------------------could be related to band size
+            count++;
+        }
+    }
+}
@@ -8,25 +8,52 @@
 #include <Eigen/Sparse>
 
 #include "narrowBand.h"
+#include "csr.h"
+#include "stencil.h"
+#include "sell.h"
+#include "packed.h"
+#include "sym.h"
+#include "tiling.h"
+#include "domain.h"
 
 using namespace std;
 
 //linear indexing is used throughout
 //linear index = x*num_y*num_z + y*num_z + z
 
-typedef boost::shared_ptr<Eigen::SparseMatrix<float> > SparseMatrixPtr;
-
 struct qp_args{
     SparseMatrixPtr R;
+    //set instead of R when the band stencil is applied matrix-free
+    stencil_argsPtr stencil;
+    //optional temporally blocked copy of the stencil, swept instead of it when set
+    tiled_stencilPtr tiles;
+    //optional sliced ellpack copy of R, swept instead of R when set
+    sell_matPtr sell;
+    //optional int8/int16 copy of R, swept instead of R when set, the last sweep uses R
+    packed_matPtr packed;
+    //optional strict upper triangle of R, swept instead of R when set
+    csr_matPtr upper;
+    //optional z slab split of R with private rows per worker, swept instead of R when set
+    band_domainsPtr domains;
     vector<float> invdg;
     vector<float> lb;
     vector<float> ub;
     vector<float> x;
     int iter;
+    //stop once a sweep changes no unknown by more than tol, 0 runs all iter sweeps
+    float tol;
+    //seconds allowed for the sweeps, the latest iterate is returned once they pass. 0 for no limit
+    float deadline;
+    //solve exactly with the active set solver instead of sweeping R
+    bool direct;
+    //sweeps before unknowns held at a bound are removed, 0 keeps all unknowns
+    int presolve;
+    //worker threads for cpu sweeps, 0 uses all hardware threads
+    int threads;
 };
 typedef boost::shared_ptr<qp_args> qp_argsPtr;
 
-//make H matrix
+//make H matrix, returns H'H
 SparseMatrixPtr getHMat(gridPtr tightBand, gridPtr indexMap);
 
 //get lower bound vector
@@ -35,11 +62,21 @@ vector<float> getlb(gridPtr margin, gridPtr volume, const vector<int>& indexes);
 vector<float> getub(gridPtr margin, gridPtr volume, const vector<int>& indexes);
 
 //prepare quadratic program arguments
-qp_argsPtr primeQP(gridPtr volume, gridPtr margin, bandsPtr bnds);
+qp_argsPtr primeQP(gridPtr volume, gridPtr margin, bandsPtr bnds, const bool USING_STENCIL=false);
+//prepare quadratic program arguments with unknowns numbered in the order of indexes
+qp_argsPtr primeQP(gridPtr volume, gridPtr margin, bandsPtr bnds, const vector<int>& indexes, const bool USING_STENCIL);
+
+//seed x from a previous embedding grid aligned to volume by world transform
+//only unknowns landing inside the previous band are seeded, values are clamped to [lb, ub].
+//falls back to the cold start and returns 0 when fewer than half the unknowns overlap
+int warmStart(gridPtr prevF, gridPtr volume, const vector<int>& indexes, float outside,
+    const vector<float>& lb, const vector<float>& ub, vector<float>& x);
 
 //************************************************************************************
 //get feature index vector from feature map and index map
 bool lowtohigh(int i, int j);
 vector<int> getFeatureIndexes(gridPtr featureMap, gridPtr indexMap);
+//reset solution at sorted feature indexes
+void setFeatureValues(vector<float>& x, const vector<int>& featureIndexes);
 
 #endif
@@ -0,0 +1,205 @@
+
+#include "qpsolver.h"
+
+using namespace std;
+
+QPSolver::QPSolver(){
+    R.rows=0;
+    R.cols=0;
+    stop_time=0;
+}
+
+QPSolver::~QPSolver(){
+    release();
+}
+
+//copy R of args into owned compressed rows and size the buffers
+void QPSolver::setup(qp_argsPtr args){
+    int n = args->x.size();
+    buf1.resize(n);
+    buf2.resize(n);
+    if(args->stencil || args->sell || args->upper || args->domains || args->direct){
+        //no compressed rows are swept
+        vector<int>().swap(R.jc);
+        vector<int>().swap(R.ir);
+        vector<float>().swap(R.pr);
+        source.reset();
+        R.rows = n;
+        R.cols = n;
+        return;
+    }
+
+    //already copied, or dropped by the caller after setup
+    if(args->R ? source.lock()==args->R : (R.rows==n && !R.jc.empty())){
+        return;
+    }
+    if(!args->R){
+        cerr<<"QPSolver has no matrix to sweep"<<endl;
+        return;
+    }
+
+    //R is symmetric so its compressed columns are its compressed rows. the one
+    //non-symmetric input is the M of conf, whose transpose is the matrix meant to be swept
+    SparseMatrixPtr A = args->R;
+    A->makeCompressed();
+    source = A;
+    R.rows = A->rows();
+    R.cols = A->cols();
+    R.jc.assign(A->outerIndexPtr(), A->outerIndexPtr()+R.rows+1);
+    R.ir.assign(A->innerIndexPtr(), A->innerIndexPtr()+A->nonZeros());
+    R.pr.assign(A->valuePtr(), A->valuePtr()+A->nonZeros());
+}
+
+//run args->iter sweeps starting at args->x
+vector<float> QPSolver::solve(qp_argsPtr args){
+    last = qp_status();
+    stop_time = args->deadline>0 ? wallTime()+args->deadline : 0;
+    setup(args);
+    if(args->x.empty()) return args->x;
+
+    if(args->direct){
+        vector<float> x (args->x);
+        int it = direct.solve(args->R, args->invdg, args->lb, args->ub, x);
+        if(it!=ACTIVE_SET_FAILED){
+            last.sweeps = abs(it);
+            return x;
+        }
+        //fall back to sweeping the compressed rows
+        cerr<<"direct solve failed, sweeping instead"<<endl;
+        qp_argsPtr sweep_args (new qp_args(*args));
+        sweep_args->direct = false;
+        x = solve(sweep_args);
+        last.failed = true;
+        return x;
+    }
+    if(args->stencil && !args->tiles){
+        return runStencilQP(args->stencil, args->x, args->invdg, args->lb, args->ub, args->iter, args->tol,
+            stop_time, &last);
+    }
+
+    if(!pool || pool->size()!=getNumThreads(args->threads)){
+        pool.reset(new sweep_pool(args->threads));
+    }
+    if(args->tiles){
+        return runTiledStencilQP(args->tiles, args->x, args->iter, args->tol, *pool, stop_time, &last);
+    }
+
+    copy(args->x.begin(), args->x.end(), buf1.begin());
+    float* bufs[2] = {&buf1[0], &buf2[0]};
+    bool plain = !(args->sell || args->packed || args->upper || args->domains);
+    if(plain && args->presolve>0 && args->iter>args->presolve){
+        //sweep everything for a few iterations, then only the unknowns not pinned at a bound.
+        //pins are checked against the full system again every args->presolve sweeps
+        int done = sweep(args, NULL, NULL, bufs, args->invdg, args->lb, args->ub, args->presolve);
+        if(done==args->presolve){
+            vector<float> x (bufs[0], bufs[0]+args->x.size());
+            while(done<args->iter){
+                if(stop_time>0 && wallTime()>=stop_time){
+                    last.timed_out = true;
+                    cout<<"stopped at deadline after "<<done<<" sweeps"<<endl;
+                    break;
+                }
+                qp_presolvePtr P = getPresolve(R, x, args->invdg, args->lb, args->ub);
+                int nfree = P->free_.size();
+                if(nfree==0) break;
+                rbuf1.resize(nfree);
+                rbuf2.resize(nfree);
+                for(int k=0; k<nfree; k++) rbuf1[k] = x[P->free_[k]];
+                float* rbufs[2] = {&rbuf1[0], &rbuf2[0]};
+                int stage = min(args->presolve, args->iter-done);
+                int m = sweep(args, &P->R, &P->b[0], rbufs, P->invdg, P->lb, P->ub, stage);
+                for(int k=0; k<nfree; k++) x[P->free_[k]] = rbufs[0][k];
+                done += m;
+                if(m<stage) break;
+            }
+            return x;
+        }
+    }
+    else{
+        //a packed solve keeps its last sweep for a fp32 polishing pass over R
+        int total = (args->packed && args->iter>0) ? args->iter-1 : args->iter;
+        sweep(args, NULL, NULL, bufs, args->invdg, args->lb, args->ub, total);
+        if(total<args->iter){
+            if(runSweeps(R, bufs, args->invdg, args->lb, args->ub, 1, *pool)) swap(bufs[0], bufs[1]);
+            last.sweeps++;
+            last.residual = maxChange(bufs[0], bufs[1], args->x.size());
+        }
+    }
+
+    if(bufs[0]==&buf2[0]) return buf2;
+    return buf1;
+}
+
+//run up to iter sweeps, stopping early at args->tol or the deadline
+int QPSolver::sweep(qp_argsPtr args, const csr_mat* A, const float* b, float* bufs[2],
+    const vector<float>& invdg, const vector<float>& lb, const vector<float>& ub, int iter)
+{
+    int n = lb.size();
+    //without a tolerance or deadline all sweeps run in one pass over the pool
+    int chunk = (args->tol>0 || stop_time>0) ? QP_CHECK_SWEEPS : iter;
+    int done = 0;
+    while(done<iter){
+        int m = min(chunk, iter-done);
+        int result;
+        if(A){
+            result = runSweeps(*A, bufs, invdg, lb, ub, m, *pool, b);
+        }
+        else if(args->sell){
+            result = runSellSweeps(*(args->sell), bufs, invdg, lb, ub, m, *pool);
+        }
+        else if(args->packed){
+            result = runPackedSweeps(*(args->packed), bufs, invdg, lb, ub, m, *pool);
+        }
+        else if(args->upper){
+            result = runSymSweeps(*(args->upper), bufs, invdg, lb, ub, m, *pool);
+        }
+        else if(args->domains){
+            result = runDomainSweeps(*(args->domains), bufs, m, *pool);
+        }
+        else{
+            result = runSweeps(R, bufs, invdg, lb, ub, m, *pool);
+        }
+        //keep the latest iterate in bufs[0], the one before it in bufs[1]
+        if(result) swap(bufs[0], bufs[1]);
+        done += m;
+
+        if(args->tol>0 && m>0 && maxChange(bufs[0], bufs[1], n)<args->tol){
+            cout<<"converged after "<<last.sweeps+done<<" sweeps"<<endl;
+            break;
+        }
+        if(stop_time>0 && done<iter && wallTime()>=stop_time){
+            last.timed_out = true;
+            cout<<"stopped at deadline after "<<last.sweeps+done<<" sweeps"<<endl;
+            break;
+        }
+    }
+    last.sweeps += done;
+    if(done>0) last.residual = maxChange(bufs[0], bufs[1], n);
+    return done;
+}
+
+//free compressed rows, buffers and worker threads
+void QPSolver::release(){
+    vector<int>().swap(R.jc);
+    vector<int>().swap(R.ir);
+    vector<float>().swap(R.pr);
+    vector<float>().swap(buf1);
+    vector<float>().swap(buf2);
+    vector<float>().swap(rbuf1);
+    vector<float>().swap(rbuf2);
+    R.rows=0;
+    R.cols=0;
+    source.reset();
+    pool.reset();
+    direct.release();
+}
+
+//sweeps, deadline flag and residual of the last solve
+const qp_status& QPSolver::status() const{
+    return last;
+}
+
+//number of unknowns of the last setup
+int QPSolver::size() const{
+    return R.rows;
+}
@@ -0,0 +1,71 @@
+#ifndef QPSOLVER_H
+#define QPSOLVER_H
+
+#include "primeqp.h"
+#include "sweep.h"
+#include "activeset.h"
+#include "presolve.h"
+
+using namespace std;
+
+//reusable solver for the smoothing quadratic program
+//owns the compressed rows of R, the iteration buffers, the worker threads and
+//the factorization of the direct solver.
+//storage is kept between solves and reused while the band size fits,
+//release() or the destructor frees it
+class QPSolver{
+private:
+    csr_mat R;
+    //matrix R was copied from, to skip the copy when the same matrix is solved again
+    boost::weak_ptr<Eigen::SparseMatrix<float> > source;
+    vector<float> buf1;
+    vector<float> buf2;
+    //iteration buffers of the presolved system
+    vector<float> rbuf1;
+    vector<float> rbuf2;
+    boost::shared_ptr<sweep_pool> pool;
+    ActiveSetSolver direct;
+    //outcome of the last solve
+    qp_status last;
+    //wallTime() at which the running solve stops, 0 for none
+    double stop_time;
+
+    //run up to iter sweeps of A with b, or of the storage of args when A is NULL,
+    //stopping early at args->tol or the deadline. leaves the latest iterate in bufs[0] and the one
+    //before it in bufs[1], returns number of sweeps run
+    int sweep(qp_argsPtr args, const csr_mat* A, const float* b, float* bufs[2],
+        const vector<float>& invdg, const vector<float>& lb, const vector<float>& ub, int iter);
+
+public:
+    QPSolver();
+    ~QPSolver();
+
+    //copy R of args into owned compressed rows and size the buffers.
+    //the copy is skipped when args->R is the matrix of the last setup, so a matrix changed in
+    //place needs release() first. after setup the caller may drop args->R to keep only the
+    //owned copy, later solves of the same size then sweep the owned rows
+    void setup(qp_argsPtr args);
+
+    //run args->iter sweeps starting at args->x
+    //sweeps args->tiles, args->stencil, args->sell, args->packed, args->upper or args->domains when set,
+    //otherwise the compressed rows of args->R.
+    //with args->tol set, convergence is checked every QP_CHECK_SWEEPS sweeps.
+    //with args->deadline set, the time is checked as often and the latest iterate is returned
+    //once the deadline has passed, status() tells whether it stopped early.
+    //with args->direct set, the active set solver is used instead and the deadline is not checked,
+    //if it fails the compressed rows are swept and status() reports failed.
+    //with args->presolve set, unknowns pinned at a bound after that many sweeps are
+    //dropped from the remaining sweeps of the compressed rows
+    vector<float> solve(qp_argsPtr args);
+
+    //sweeps, deadline and failure flags and residual of the last solve
+    const qp_status& status() const;
+
+    //free compressed rows, buffers, worker threads and factorization
+    void release();
+
+    //number of unknowns of the last setup
+    int size() const;
+};
+
+#endif
@@ -3,132 +3,106 @@
 
 using namespace std;
 
-//more formatting for rapid algorithm
-//takes advantage of sparseness
-vector<int> getIr(SparseMatrixPtr R){
-    vector<int> ir (R->nonZeros());
-    int count=0;
-    for (int k=0; k<R->outerSize(); ++k){
-        for (Eigen::SparseMatrix<float>::InnerIterator it(*R,k); it; ++it){
-            ir[count] = it.row();
-            count++;
-        }
-    }
-    return ir;
-
-}
-vector<int> getJc(SparseMatrixPtr R){
-    vector<int> jc ((R->cols())+1);
-    jc[0]=0;
-    int sum=0;
-    for (int k=0; k<R->outerSize(); ++k){
-        for (Eigen::SparseMatrix<float>::InnerIterator it(*R,k); it; ++it){
-            sum++;
-        }
-        jc[k+1]=sum;
-    }
-    return jc;
-}
-vector<float> getPr(SparseMatrixPtr R){
-    vector<float> pr (R->nonZeros(), 0);
-    int count=0;
-    for (int k=0; k<R->outerSize(); ++k){
-        for (Eigen::SparseMatrix<float>::InnerIterator it(*R,k); it; ++it){
-            pr[count]=it.value();
-            count++;
-        }
-    }
-    return pr;
-}
-
-//row increment
-void doStep(int row, const vector<float>& in, vector<float>& out,
-    const vector<int>& ir, const vector<int>& jc, const vector<float>& pr, const vector<float>& invdg,
-    const vector<float>& lb, const vector<float>& ub)
-{
-    float res = 0;
-    int start = jc[row];
-    int end   = jc[row+1];
-    int i;
-
-    for(i = start; i < end; i++)
-        res +=  pr[i]*in[ir[i]];
-
-    res = (in[row]-res*invdg[row])*0.5;
-    if(res < lb[row]) res = lb[row];
-    if(res > ub[row]) res = ub[row];
-    out[row] = res;
-}
-
 //quadratic programming optimization algorithm
 vector<float> runQP(qp_argsPtr args, const vector<int> &featureIndexes, const bool USING_FEATURES){
-    //get ir and jc
-    vector<int> ir = getIr(args->R);
-    vector<int> jc = getJc(args->R);
-    vector<float> pr = getPr(args->R);
-
-    int size = args->R->rows();
-
-    vector<float>* buf1 = new vector<float>(args->x);
-    vector<float>* buf2 = new vector<float>(size, 0);
-    vector<float>* in;
-    vector<float>* out;
-
-    //perform algorithm
-    for(int i = 0; i < args->iter; i++){
-        if(i % 2){
-            in = buf2;
-            out = buf1;
-        }
-        else{
-            in = buf1;
-            out = buf2;
-        }
+    QPSolver solver;
+    return runQP(args, featureIndexes, USING_FEATURES, solver);
+}
 
-        for(int r = 0; r < size; r++){
-            doStep(r, *in, *out, ir, jc, pr, args->invdg, args->lb, args->ub);
-        }
-    }
+//quadratic programming optimization algorithm using a reusable solver
+vector<float> runQP(qp_argsPtr args, const vector<int> &featureIndexes, const bool USING_FEATURES, QPSolver &solver){
+    vector<float> x = solver.solve(args);
     if(USING_FEATURES){
         //reset values at feature points
-        int count=0;
-        for(int i=0; i<args->x.size(); i++){
-            if(i==featureIndexes[count]){
-                (*out)[i]=0.2; //<--------------------------------------could be related to band size
-                count++;
-            }
-        }
+        setFeatureValues(x, featureIndexes);
     }
 
     cout<<"quadratic program finished"<<endl;
-    return *out;
+    return x;
 }
 
 
 
 //Function for computing weighted voxel grid for marching cubes
 //takes as input a binary volume
-gridPtr optimize(gridPtr volume, gridPtr featureMap, const bool USING_FEATURES, const bool USING_CUDA){
+gridPtr optimize(gridPtr volume, gridPtr featureMap, const bool USING_FEATURES, const bool USING_CUDA,
+    const qp_options &opts, QPSolver *solver, gridPtr prevF){
     int BAND_SIZE=4.0;
     //prime quadratic programming arguments
     //prepare margin
-    gridPtr margin = getsqrt(getsqdist(fastPerim(volume)));
+    gridPtr perim = fastPerim(volume);
+    gridPtr margin = getsqrt(getsqdist(perim));
     cout<<"margin calculated"<<endl;
     //prepare bands
-    bandsPtr bnds = createBands(margin, BAND_SIZE);
+    bandsPtr bnds;
+    if(opts.flat_band>0){
+        //shrink the band away from features
+        gridPtr radius = getBandRadius(featureMap, BAND_SIZE, opts.flat_band, (int)BAND_SIZE);
+        bnds = createAdaptiveBands(margin, getsqdist_index(perim), radius);
+    }
+    else{
+        bnds = createBands(margin, BAND_SIZE);
+    }
     cout<<"bands created"<<endl;
     //get band point indexes
     vector<int> indexes = findIndexes(bnds->band);
+    if(opts.reorder){
+        //number unknowns along the morton curve, F is written through indexes
+        //so the solution lands back on the right voxels
+        indexes = mortonOrder(bnds->band, indexes);
+    }
     //create index map
     gridPtr indexMap = getIndexMap(bnds->band, indexes);
     vector<int> featureIndexes = getFeatureIndexes(featureMap, indexMap);
     cout<<"indexes stored"<<endl;
 
     //prepare qp_args
-    qp_argsPtr args = primeQP(volume, margin, bnds);
+    //the direct solver factors R, so it is always assembled for it
+    qp_argsPtr args = primeQP(volume, margin, bnds, indexes, opts.matrix_free && !opts.direct);
+    args->threads = opts.threads;
+    args->direct = opts.direct;
+    args->presolve = opts.presolve;
+    args->tol = opts.tol;
+    args->deadline = opts.deadline;
+    if(prevF){
+        //seed band unknowns from the previous embedding
+        warmStart(prevF, volume, indexes, BAND_SIZE+1.0, args->lb, args->ub, args->x);
+    }
+    if(args->stencil && opts.time_steps>1){
+        //advance overlapping tiles several sweeps at a time
+        args->tiles = getTiledStencil(args->stencil, args->invdg, args->lb, args->ub, opts.time_steps);
+    }
+    if(args->direct){
+        //solved from R directly, no sweep storage
+    }
+    else if(opts.sell && args->R){
+        //build sliced ellpack copy of R once
+        args->sell = getSell(*sparseToCsr(args->R));
+    }
+    else if(opts.packed && args->R){
+        //build reduced precision copy of R once, null when R does not pack exactly
+        args->packed = getPacked(*sparseToCsr(args->R));
+    }
+    else if(opts.symmetric && args->R){
+        //keep the upper triangle only and drop the full matrix
+        args->upper = getUpper(*sparseToCsr(args->R));
+        args->R.reset();
+    }
+    else if(opts.domains && args->R){
+        //one z slab per worker thread
+        args->domains = getDomains(*sparseToCsr(args->R), indexes, volume->dims, args->invdg,
+            args->lb, args->ub, getNumThreads(opts.threads));
+    }
 
     //run quadratic programming
-    vector<float> x = runQP(args, featureIndexes, USING_FEATURES);
+    QPSolver local;
+    QPSolver &qp = solver ? *solver : local;
+    if(args->R && !args->direct){
+        //the solver keeps its own compressed rows, so the eigen copy is dropped before sweeping
+        qp.setup(args);
+        args->R.reset();
+    }
+    vector<float> x = runQP(args, featureIndexes, USING_FEATURES, qp);
 
     //prepare new voxel grid with embedding function
     gridPtr F = copyGrid(volume);
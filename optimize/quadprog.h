@@ -4,26 +4,55 @@
 #include <math.h>
 
 #include "primeqp.h"
+#include "sweep.h"
+#include "qpsolver.h"
+#include "reorder.h"
 
 using namespace std;
 
-//more formatting for rapid algorithm
-//takes advantage of sparseness
-vector<int> getIr(SparseMatrixPtr R);
-vector<int> getJc(SparseMatrixPtr R);
-vector<float> getPr(SparseMatrixPtr R);
-
-//row increment
-void doStep(int row, const vector<float>& in, vector<float>& out,
-    const vector<int>& ir, const vector<int>& jc, const vector<float>& pr, const vector<float>& invdg,
-    const vector<float>& lb, const vector<float>& ub);
-
 //quadratic programming optimization algorithm
 vector<float> runQP(qp_argsPtr args, const vector<int> &featureIndexes, const bool USING_FEATURES);
+//quadratic programming optimization algorithm using a reusable solver
+vector<float> runQP(qp_argsPtr args, const vector<int> &featureIndexes, const bool USING_FEATURES, QPSolver &solver);
+
+//options for the smoothing quadratic program
+struct qp_options{
+    //apply H'H from the band stencil instead of assembling R, runs on the cpu
+    bool matrix_free;
+    //worker threads for cpu sweeps, 0 uses all hardware threads
+    int threads;
+    //sweep a sliced ellpack copy of R, runs on the cpu
+    bool sell;
+    //sweep an int8 coefficient, int16 offset copy of R, runs on the cpu
+    bool packed;
+    //keep only the upper triangle of R and sweep with a symmetric product, runs on the cpu
+    bool symmetric;
+    //split the band into z slabs, one per worker thread, with private rows and halo exchange
+    bool domains;
+    //number band unknowns along the morton curve for locality
+    bool reorder;
+    //with matrix_free, sweeps advanced per cache sized tile before moving on, 0 or 1 disables
+    int time_steps;
+    //solve exactly with a box constrained active set method and sparse LDLT, runs on the cpu
+    bool direct;
+    //sweeps before unknowns held at a bound are removed from the system, 0 disables
+    int presolve;
+    //band radius away from features, the band keeps its full radius near features. 0 disables
+    float flat_band;
+    //stop sweeping once no unknown changes by more than tol, 0 runs all sweeps
+    float tol;
+    //seconds allowed for sweeping on the cpu, the latest iterate is kept once they pass. 0 for no limit
+    float deadline;
+
+    qp_options():matrix_free(false), threads(0), sell(false), packed(false), symmetric(false), domains(false), reorder(false), time_steps(0), direct(false), presolve(0), flat_band(0), tol(0), deadline(0){}
+};
 
 //Function for computing weighted voxel grid for marching cubes
 //takes as input a binary volume
-gridPtr optimize(gridPtr volume, gridPtr featureMap, const bool USING_FEATURES, const bool USING_CUDA);
+//pass a solver to reuse its storage across calls
+//pass the embedding of a previous frame as prevF to warm start the band unknowns
+gridPtr optimize(gridPtr volume, gridPtr featureMap, const bool USING_FEATURES, const bool USING_CUDA,
+    const qp_options &opts=qp_options(), QPSolver *solver=NULL, gridPtr prevF=gridPtr());
 
 
 #endif
@@ -0,0 +1,36 @@
+
+#include "reorder.h"
+
+using namespace std;
+
+//spread the low 21 bits of v so there are two zero bits between each
+unsigned long long spreadBits(unsigned long long v){
+    v &= 0x1fffff;
+    v = (v | (v << 32)) & 0x1f00000000ffffULL;
+    v = (v | (v << 16)) & 0x1f0000ff0000ffULL;
+    v = (v | (v << 8))  & 0x100f00f00f00f00fULL;
+    v = (v | (v << 4))  & 0x10c30c30c30c30c3ULL;
+    v = (v | (v << 2))  & 0x1249249249249249ULL;
+    return v;
+}
+
+//interleave bits of voxel subscripts, x in the lowest bit
+unsigned long long mortonCode(const Eigen::Vector3i &subs){
+    return spreadBits(subs[0]) | (spreadBits(subs[1]) << 1) | (spreadBits(subs[2]) << 2);
+}
+
+//reorder linear indexes of band voxels along the morton curve
+//stencil neighbours of a voxel end up close together in the unknown vector
+vector<int> mortonOrder(gridPtr band, const vector<int>& indexes){
+    vector<pair<unsigned long long,int> > codes (indexes.size());
+    for(int i=0; i<indexes.size(); i++){
+        codes[i] = make_pair(mortonCode(band->ind2sub(indexes[i])), indexes[i]);
+    }
+    sort(codes.begin(), codes.end());
+
+    vector<int> out (indexes.size(), 0);
+    for(int i=0; i<codes.size(); i++){
+        out[i] = codes[i].second;
+    }
+    return out;
+}
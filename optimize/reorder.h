@@ -0,0 +1,15 @@
+#ifndef REORDER_H
+#define REORDER_H
+
+#include "grid.h"
+
+using namespace std;
+
+//interleave bits of voxel subscripts, x in the lowest bit
+unsigned long long mortonCode(const Eigen::Vector3i &subs);
+
+//reorder linear indexes of band voxels along the morton curve
+//stencil neighbours of a voxel end up close together in the unknown vector
+vector<int> mortonOrder(gridPtr band, const vector<int>& indexes);
+
+#endif
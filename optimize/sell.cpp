@@ -0,0 +1,143 @@
+
+#include "sell.h"
+#include "sweep.h"
+
+using namespace std;
+
+//function for sorting rows by decreasing length
+bool longerRow(const pair<int,int> &a, const pair<int,int> &b){
+    if(a.first!=b.first) return (a.first>b.first);
+    return (a.second<b.second);
+}
+
+//convert compressed rows to SELL-C-sigma
+sell_matPtr getSell(const csr_mat& R, int sigma){
+    sell_matPtr A (new sell_mat());
+    A->rows = R.rows;
+    A->sigma = sigma;
+    A->nchunks = (R.rows+SELL_C-1)/SELL_C;
+    A->perm.assign(A->nchunks*SELL_C, -1);
+
+    //sort rows by length within each window
+    vector<pair<int,int> > lens (R.rows);
+    for(int r=0; r<R.rows; r++){
+        lens[r] = make_pair(R.jc[r+1]-R.jc[r], r);
+    }
+    for(int w=0; w<R.rows; w+=sigma){
+        int end = min(R.rows, w+sigma);
+        sort(lens.begin()+w, lens.begin()+end, longerRow);
+    }
+    for(int r=0; r<R.rows; r++){
+        A->perm[r] = lens[r].second;
+    }
+
+    //chunk lengths and offsets
+    A->cs.assign(A->nchunks+1, 0);
+    A->cl.assign(A->nchunks, 0);
+    for(int c=0; c<A->nchunks; c++){
+        int len=0;
+        for(int lane=0; lane<SELL_C; lane++){
+            int row = A->perm[c*SELL_C+lane];
+            if(row>=0) len = max(len, R.jc[row+1]-R.jc[row]);
+        }
+        A->cl[c] = len;
+        A->cs[c+1] = A->cs[c]+len*SELL_C;
+    }
+
+    //fill columns, padding points at column 0 with value 0
+    A->col.assign(A->cs[A->nchunks], 0);
+    A->val.assign(A->cs[A->nchunks], 0);
+    for(int c=0; c<A->nchunks; c++){
+        for(int lane=0; lane<SELL_C; lane++){
+            int row = A->perm[c*SELL_C+lane];
+            if(row<0) continue;
+            for(int i=R.jc[row]; i<R.jc[row+1]; i++){
+                int j = i-R.jc[row];
+                A->col[A->cs[c]+j*SELL_C+lane] = R.ir[i];
+                A->val[A->cs[c]+j*SELL_C+lane] = R.pr[i];
+            }
+        }
+    }
+
+    return A;
+}
+
+//products of one chunk, acc[lane] = row of chunk slot lane times x
+inline void sellChunk(const sell_mat& A, int c, const float* __restrict__ x, float* __restrict__ acc){
+    for(int lane=0; lane<SELL_C; lane++){
+        acc[lane]=0;
+    }
+    const int* __restrict__ col = A.col.empty() ? NULL : &(A.col[A.cs[c]]);
+    const float* __restrict__ val = A.val.empty() ? NULL : &(A.val[A.cs[c]]);
+    for(int j=0; j<A.cl[c]; j++){
+        //one column of the chunk, vectorizes across lanes
+        for(int lane=0; lane<SELL_C; lane++){
+            acc[lane] += val[j*SELL_C+lane]*x[col[j*SELL_C+lane]];
+        }
+    }
+}
+
+//jacobi update of chunks [begin,end) from in to out
+//out = clamp((in-R*in*invdg)/2, lb, ub)
+void sellSweepChunks(const sell_mat& A, int begin, int end, const float* in, float* out,
+    const float* invdg, const float* lb, const float* ub)
+{
+    float acc[SELL_C];
+    for(int c=begin; c<end; c++){
+        sellChunk(A, c, in, acc);
+        for(int lane=0; lane<SELL_C; lane++){
+            int row = A.perm[c*SELL_C+lane];
+            if(row<0) continue;
+            float res = (in[row]-acc[lane]*invdg[row])*0.5f;
+            res = max(res, lb[row]);
+            res = min(res, ub[row]);
+            out[row] = res;
+        }
+    }
+}
+
+//data shared by sell sweep workers
+struct sell_job{
+    const sell_mat* A;
+    const float* invdg;
+    const float* lb;
+    const float* ub;
+    float* bufs[2];
+    vector<int> blocks;
+    int iter;
+    boost::barrier* sync;
+};
+
+//sweep the chunk block of worker t for every iteration
+void sellWorker(int t, sell_job& job){
+    for(int i=0; i<job.iter; i++){
+        sellSweepChunks(*job.A, job.blocks[t], job.blocks[t+1], job.bufs[i%2], job.bufs[(i+1)%2],
+            job.invdg, job.lb, job.ub);
+        job.sync->wait();
+    }
+}
+
+//run iter jacobi sweeps starting at bufs[0], chunk blocks are swept in parallel on the pool
+//returns index of the buffer holding the result
+int runSellSweeps(const sell_mat& A, float* bufs[2], const vector<float>& invdg,
+    const vector<float>& lb, const vector<float>& ub, int iter, sweep_pool& pool)
+{
+    if(A.rows==0) return 0;
+
+    boost::barrier sync (pool.size());
+    sell_job job;
+    job.A = &A;
+    job.invdg = &invdg[0];
+    job.lb = &lb[0];
+    job.ub = &ub[0];
+    job.bufs[0] = bufs[0];
+    job.bufs[1] = bufs[1];
+    //chunk blocks with balanced padded entries
+    job.blocks = getBlocks(A.cs, A.nchunks, pool.size());
+    job.iter = iter;
+    job.sync = &sync;
+
+    pool.run(boost::bind(sellWorker, _1, boost::ref(job)));
+
+    return iter % 2;
+}
@@ -0,0 +1,45 @@
+#ifndef SELL_H
+#define SELL_H
+
+#include "csr.h"
+#include "parallel.h"
+
+using namespace std;
+
+//rows per chunk, one simd register of floats
+const int SELL_C = 8;
+
+//sliced ellpack (SELL-C-sigma) storage
+//rows are sorted by length within windows of sigma rows and packed into chunks of
+//SELL_C rows. each chunk is padded to its longest row and stored column by column,
+//so one column of a chunk is a contiguous run of SELL_C entries
+struct sell_mat{
+    int rows;
+    int sigma;
+    int nchunks;
+    //row held by each chunk slot, -1 for padding slots
+    vector<int> perm;
+    //offset of each chunk in col/val, size nchunks+1
+    vector<int> cs;
+    //padded row length of each chunk
+    vector<int> cl;
+    //column indices and values, padding entries have value 0
+    vector<int> col;
+    vector<float> val;
+};
+typedef boost::shared_ptr<sell_mat> sell_matPtr;
+
+//convert compressed rows to SELL-C-sigma
+sell_matPtr getSell(const csr_mat& R, int sigma=256);
+
+//jacobi update of chunks [begin,end) from in to out
+//out = clamp((in-R*in*invdg)/2, lb, ub)
+void sellSweepChunks(const sell_mat& A, int begin, int end, const float* in, float* out,
+    const float* invdg, const float* lb, const float* ub);
+
+//run iter jacobi sweeps starting at bufs[0], chunk blocks are swept in parallel on the pool
+//returns index of the buffer holding the result
+int runSellSweeps(const sell_mat& A, float* bufs[2], const vector<float>& invdg,
+    const vector<float>& lb, const vector<float>& ub, int iter, sweep_pool& pool);
+
+#endif
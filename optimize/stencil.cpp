@@ -0,0 +1,245 @@
+
+#include "stencil.h"
+#include "parallel.h"
+#include "sweep.h"
+
+using namespace std;
+
+//get row of H'H for unknown at linear index lin
+//each tight voxel c contributes one row x(c-1)-2x(c)+x(c+1) of H per axis,
+//so unknown p picks up entries from the tight voxels p-1, p and p+1 along that axis
+void getStencilRow(const vector<float>& tight, const Eigen::Vector3i& dims, int lin, float coef[3][5]){
+    int stride[3] = {1, dims[0], dims[0]*dims[1]};
+    int subs[3];
+    subs[2] = lin/(dims[0]*dims[1]);
+    subs[1] = (lin%(dims[0]*dims[1]))/dims[0];
+    subs[0] = lin%dims[0];
+    //weights of second difference
+    const float w[3] = {1.0, -2.0, 1.0};
+
+    for(int a=0; a<3; a++){
+        for(int o=0; o<5; o++){
+            coef[a][o]=0.0;
+        }
+        for(int d=-1; d<=1; d++){
+            int c = subs[a]+d;
+            if(c<0 || c>=dims[a]) continue;
+            if(tight[lin+d*stride[a]]==0.0) continue;
+            for(int e=-1; e<=1; e++){
+                coef[a][d+e+2] += w[d+1]*w[e+1];
+            }
+        }
+    }
+}
+
+//entries of one row of R are at most 4 offsets on each axis
+const int MAX_ROW_ENTRIES = 12;
+
+//scratch for assembling rows of R
+struct hcsr_scratch{
+    vector<float> tight;
+    vector<float> map_;
+    Eigen::Vector3i dims;
+    //fixed width rows, MAX_ROW_ENTRIES per unknown
+    vector<int> cols;
+    vector<float> vals;
+    vector<int> counts;
+};
+
+//assemble rows [begin,end) of R into fixed width scratch rows
+void assembleHRows(int begin, int end, const vector<int>& indexes, hcsr_scratch& s, vector<float>& dg){
+    int stride[3] = {1, s.dims[0], s.dims[0]*s.dims[1]};
+    for(int r=begin; r<end; r++){
+        int lin = indexes[r];
+        float coef[3][5];
+        getStencilRow(s.tight, s.dims, lin, coef);
+        dg[r] = coef[0][2]+coef[1][2]+coef[2][2];
+
+        int* cols = &(s.cols[r*MAX_ROW_ENTRIES]);
+        float* vals = &(s.vals[r*MAX_ROW_ENTRIES]);
+        int n=0;
+        for(int a=0; a<3; a++){
+            for(int o=-2; o<=2; o++){
+                if(o==0 || coef[a][o+2]==0.0) continue;
+                //insert sorted by column
+                int col = (int)s.map_[lin+o*stride[a]];
+                int pos = n;
+                while(pos>0 && cols[pos-1]>col){
+                    cols[pos] = cols[pos-1];
+                    vals[pos] = vals[pos-1];
+                    pos--;
+                }
+                cols[pos] = col;
+                vals[pos] = coef[a][o+2];
+                n++;
+            }
+        }
+        s.counts[r] = n;
+    }
+}
+
+//copy fixed width scratch rows [begin,end) into compressed rows
+void compactHRows(int begin, int end, const hcsr_scratch& s, csr_matPtr R){
+    for(int r=begin; r<end; r++){
+        int dst = R->jc[r];
+        for(int n=0; n<s.counts[r]; n++){
+            R->ir[dst+n] = s.cols[r*MAX_ROW_ENTRIES+n];
+            R->pr[dst+n] = s.vals[r*MAX_ROW_ENTRIES+n];
+        }
+    }
+}
+
+//assemble R = H'H - diag(H'H) in compressed rows without forming H
+//band unknowns are assembled in parallel, the diagonal of H'H is written to dg
+csr_matPtr getHCsr(gridPtr tightBand, gridPtr indexMap, const vector<int>& indexes, vector<float>& dg){
+    int nband = indexes.size();
+    hcsr_scratch s;
+    s.tight = flattenGrid(tightBand);
+    s.map_ = flattenGrid(indexMap);
+    s.dims = tightBand->dims;
+    s.cols.resize(nband*MAX_ROW_ENTRIES);
+    s.vals.resize(nband*MAX_ROW_ENTRIES);
+    s.counts.resize(nband);
+    dg.assign(nband, 0);
+
+    parallelFor(nband, boost::bind(assembleHRows, _1, _2, boost::cref(indexes), boost::ref(s), boost::ref(dg)));
+
+    //row pointers
+    csr_matPtr R (new csr_mat());
+    R->rows = nband;
+    R->cols = nband;
+    R->jc.resize(nband+1);
+    R->jc[0] = 0;
+    for(int r=0; r<nband; r++){
+        R->jc[r+1] = R->jc[r]+s.counts[r];
+    }
+    R->ir.resize(R->jc[nband]);
+    R->pr.resize(R->jc[nband]);
+
+    parallelFor(nband, boost::bind(compactHRows, _1, _2, boost::cref(s), R));
+    return R;
+}
+
+//create stencil of band unknowns, fills invdg with inverse diagonal of H'H
+stencil_argsPtr getStencil(gridPtr tightBand, gridPtr indexMap, const vector<int>& indexes, vector<float>& invdg){
+    vector<float> tight = flattenGrid(tightBand);
+    vector<float> map_ = flattenGrid(indexMap);
+    Eigen::Vector3i dims = tightBand->dims;
+    int stride[3] = {1, dims[0], dims[0]*dims[1]};
+    int nband = indexes.size();
+
+    stencil_argsPtr S (new stencil_args());
+    S->jc.push_back(0);
+    invdg.assign(nband, 0);
+
+    for(int r=0; r<nband; r++){
+        int lin = indexes[r];
+        float coef[3][5];
+        getStencilRow(tight, dims, lin, coef);
+        float dg = coef[0][2]+coef[1][2]+coef[2][2];
+        if(dg!=0.0) invdg[r] = 1.0/dg;
+
+        //interior rows have tight face neighbours on every axis
+        bool interior = (tight[lin]!=0.0);
+        for(int a=0; a<3 && interior; a++){
+            if(coef[a][0]!=STENCIL_FAR || coef[a][1]!=STENCIL_NEAR
+                    || coef[a][3]!=STENCIL_NEAR || coef[a][4]!=STENCIL_FAR){
+                interior=false;
+            }
+        }
+
+        if(interior){
+            S->interior.push_back(r);
+            for(int dist=1; dist<=2; dist++){
+                for(int a=0; a<3; a++){
+                    S->nbrs.push_back((int)map_[lin-dist*stride[a]]);
+                    S->nbrs.push_back((int)map_[lin+dist*stride[a]]);
+                }
+            }
+        }
+        else{
+            S->boundary.push_back(r);
+            for(int a=0; a<3; a++){
+                for(int o=-2; o<=2; o++){
+                    if(o==0 || coef[a][o+2]==0.0) continue;
+                    S->ir.push_back((int)map_[lin+o*stride[a]]);
+                    S->pr.push_back(coef[a][o+2]);
+                }
+            }
+            S->jc.push_back(S->ir.size());
+        }
+    }
+
+    cout<<"stencil has "<<S->interior.size()<<" interior and "<<S->boundary.size()<<" boundary rows"<<endl;
+    return S;
+}
+
+//one jacobi sweep using the stencil
+void doStencilSweep(stencil_argsPtr S, const vector<float>& in, vector<float>& out,
+    const vector<float>& invdg, const vector<float>& lb, const vector<float>& ub)
+{
+    //interior rows
+    int ninterior = S->interior.size();
+    const int* nb = S->nbrs.empty() ? NULL : &(S->nbrs[0]);
+    for(int k=0; k<ninterior; k++, nb+=12){
+        int row = S->interior[k];
+        float near_ = in[nb[0]]+in[nb[1]]+in[nb[2]]+in[nb[3]]+in[nb[4]]+in[nb[5]];
+        float far_  = in[nb[6]]+in[nb[7]]+in[nb[8]]+in[nb[9]]+in[nb[10]]+in[nb[11]];
+        float res = STENCIL_NEAR*near_+STENCIL_FAR*far_;
+
+        res = (in[row]-res*(1.0f/STENCIL_DIAG))*0.5;
+        if(res < lb[row]) res = lb[row];
+        if(res > ub[row]) res = ub[row];
+        out[row] = res;
+    }
+
+    //boundary rows
+    int nboundary = S->boundary.size();
+    for(int k=0; k<nboundary; k++){
+        int row = S->boundary[k];
+        float res = 0;
+        for(int i = S->jc[k]; i < S->jc[k+1]; i++)
+            res += S->pr[i]*in[S->ir[i]];
+
+        res = (in[row]-res*invdg[row])*0.5;
+        if(res < lb[row]) res = lb[row];
+        if(res > ub[row]) res = ub[row];
+        out[row] = res;
+    }
+}
+
+//quadratic programming optimization algorithm using the stencil
+vector<float> runStencilQP(stencil_argsPtr S, const vector<float>& x, const vector<float>& invdg,
+    const vector<float>& lb, const vector<float>& ub, int iter, float tol,
+    double stop_time, qp_status* status)
+{
+    vector<float> buf1 (x);
+    vector<float> buf2 (x.size(), 0);
+    bool timed_out = false;
+
+    //perform algorithm
+    int i;
+    for(i = 0; i < iter; i++){
+        if(i % 2) doStencilSweep(S, buf2, buf1, invdg, lb, ub);
+        else doStencilSweep(S, buf1, buf2, invdg, lb, ub);
+        if((i+1)%QP_CHECK_SWEEPS!=0 || x.empty()) continue;
+        if(tol>0 && maxChange(&buf1[0], &buf2[0], x.size())<tol){
+            i++;
+            cout<<"converged after "<<i<<" sweeps"<<endl;
+            break;
+        }
+        if(stop_time>0 && wallTime()>=stop_time && i+1<iter){
+            i++;
+            timed_out = true;
+            cout<<"stopped at deadline after "<<i<<" sweeps"<<endl;
+            break;
+        }
+    }
+    if(status){
+        status->sweeps = i;
+        status->timed_out = timed_out;
+        status->residual = (i>0 && !x.empty()) ? maxChange(&buf1[0], &buf2[0], x.size()) : 0;
+    }
+    if(i % 2) return buf2;
+    return buf1;
+}
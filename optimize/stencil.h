@@ -0,0 +1,58 @@
+#ifndef STENCIL_H
+#define STENCIL_H
+
+#include "narrowBand.h"
+#include "csr.h"
+#include "sweep.h"
+
+using namespace std;
+
+//matrix-free form of R = H'H - diag(H'H) for the second difference operator H
+//a band unknown whose 6 face neighbours are all in the tight band sees the full
+//1D stencil [1 -4 6 -4 1] along every axis, so its row only needs the 12 neighbour
+//unknowns. rows near the band boundary keep explicit sparse entries
+struct stencil_args{
+    //interior rows, applied with fixed coefficients
+    vector<int> interior;
+    //neighbour unknowns of interior rows, 12 per row:
+    //-x,+x,-y,+y,-z,+z at distance 1 followed by the same order at distance 2
+    vector<int> nbrs;
+    //boundary rows, applied from sparse entries
+    vector<int> boundary;
+    //compressed rows of boundary entries
+    vector<int> jc;
+    vector<int> ir;
+    vector<float> pr;
+};
+typedef boost::shared_ptr<stencil_args> stencil_argsPtr;
+
+//coefficients of interior rows
+const float STENCIL_NEAR = -4.0;
+const float STENCIL_FAR = 1.0;
+const float STENCIL_DIAG = 18.0;
+
+//get row of H'H for unknown at linear index lin
+//coef[axis][offset+2] holds the coefficient of the unknown offset voxels along axis
+//the diagonal is accumulated in coef[axis][2] for every axis
+void getStencilRow(const vector<float>& tight, const Eigen::Vector3i& dims, int lin, float coef[3][5]);
+
+//assemble R = H'H - diag(H'H) in compressed rows without forming H
+//band unknowns are assembled in parallel, the diagonal of H'H is written to dg
+csr_matPtr getHCsr(gridPtr tightBand, gridPtr indexMap, const vector<int>& indexes, vector<float>& dg);
+
+//create stencil of band unknowns, fills invdg with inverse diagonal of H'H
+stencil_argsPtr getStencil(gridPtr tightBand, gridPtr indexMap, const vector<int>& indexes, vector<float>& invdg);
+
+//one jacobi sweep using the stencil
+void doStencilSweep(stencil_argsPtr S, const vector<float>& in, vector<float>& out,
+    const vector<float>& invdg, const vector<float>& lb, const vector<float>& ub);
+
+//quadratic programming optimization algorithm using the stencil
+//stops early once a sweep changes no unknown by more than tol, 0 runs all iter sweeps.
+//stops at the wallTime() stop_time when it is set, checked every QP_CHECK_SWEEPS sweeps.
+//the outcome is written to status when given
+vector<float> runStencilQP(stencil_argsPtr S, const vector<float>& x, const vector<float>& invdg,
+    const vector<float>& lb, const vector<float>& ub, int iter, float tol=0,
+    double stop_time=0, qp_status* status=NULL);
+
+#endif
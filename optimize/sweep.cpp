@@ -0,0 +1,165 @@
+
+#include "sweep.h"
+
+#include <boost/date_time/posix_time/posix_time.hpp>
+
+using namespace std;
+
+//split n rows or chunks into nblocks contiguous blocks with balanced entries
+//returns nblocks+1 block boundaries
+vector<int> getBlocks(const vector<int>& starts, int n, int nblocks){
+    vector<int> blocks (nblocks+1, n);
+    blocks[0]=0;
+    //count each row as its entries plus the diagonal update
+    long total = starts[n]+n;
+    int row=0;
+    for(int b=1; b<nblocks; b++){
+        long target = (total*b)/nblocks;
+        while(row<n && starts[row]+row<target) row++;
+        blocks[b]=row;
+    }
+    return blocks;
+}
+
+//split rows into nblocks contiguous blocks with balanced nonzeros
+//returns nblocks+1 block boundaries
+vector<int> getRowBlocks(const csr_mat& R, int nblocks){
+    return getBlocks(R.jc, R.rows, nblocks);
+}
+
+//fused row kernel, jacobi update of rows [begin,end) from in to out
+//out = clamp((in-(R*in+b)*invdg)/2, lb, ub), b may be NULL
+void sweepRows(int begin, int end, const float* __restrict__ in, float* __restrict__ out,
+    const int* __restrict__ jc, const int* __restrict__ ir, const float* __restrict__ pr, const float* __restrict__ b,
+    const float* __restrict__ invdg, const float* __restrict__ lb, const float* __restrict__ ub)
+{
+    for(int row=begin; row<end; row++){
+        //two partial sums break the dependency chain of the gather-dot
+        float res0 = 0;
+        float res1 = 0;
+        int i = jc[row];
+        int stop = jc[row+1];
+        for(; i+1<stop; i+=2){
+            res0 += pr[i]*in[ir[i]];
+            res1 += pr[i+1]*in[ir[i+1]];
+        }
+        if(i<stop) res0 += pr[i]*in[ir[i]];
+        if(b) res1 += b[row];
+
+        float res = (in[row]-(res0+res1)*invdg[row])*0.5f;
+        res = max(res, lb[row]);
+        res = min(res, ub[row]);
+        out[row] = res;
+    }
+}
+
+//data shared by sweep workers
+struct sweep_job{
+    const csr_mat* R;
+    const float* invdg;
+    const float* lb;
+    const float* ub;
+    const float* b;
+    float* bufs[2];
+    vector<int> blocks;
+    int iter;
+    boost::barrier* sync;
+};
+
+//sweep the row block of worker t for every iteration
+void sweepWorker(int t, sweep_job& job){
+    const int* jc = &(job.R->jc[0]);
+    const int* ir = job.R->ir.empty() ? NULL : &(job.R->ir[0]);
+    const float* pr = job.R->pr.empty() ? NULL : &(job.R->pr[0]);
+    for(int i=0; i<job.iter; i++){
+        sweepRows(job.blocks[t], job.blocks[t+1], job.bufs[i%2], job.bufs[(i+1)%2],
+            jc, ir, pr, job.b, job.invdg, job.lb, job.ub);
+        //every row of out must be written before it is read as in
+        job.sync->wait();
+    }
+}
+
+//y = b+alpha*A*x for rows [begin,end) of compressed rows, b may be NULL or alias y
+void spmvRows(int begin, int end, const float* __restrict__ x, float* y,
+    const int* __restrict__ jc, const int* __restrict__ ir, const float* __restrict__ pr, const float* b, float alpha)
+{
+    for(int row=begin; row<end; row++){
+        float res0 = 0;
+        float res1 = 0;
+        int i = jc[row];
+        int stop = jc[row+1];
+        for(; i+1<stop; i+=2){
+            res0 += pr[i]*x[ir[i]];
+            res1 += pr[i+1]*x[ir[i+1]];
+        }
+        if(i<stop) res0 += pr[i]*x[ir[i]];
+        float res = alpha*(res0+res1);
+        if(b) res += b[row];
+        y[row] = res;
+    }
+}
+
+//y = b+alpha*A*x over compressed rows, rows are split over nthreads threads
+void csrSpmv(const csr_mat& A, const float* x, float* y, const float* b, float alpha, int nthreads){
+    if(A.rows==0) return;
+    const int* ir = A.ir.empty() ? NULL : &A.ir[0];
+    const float* pr = A.pr.empty() ? NULL : &A.pr[0];
+    parallelFor(A.rows, boost::bind(spmvRows, _1, _2, x, y, &A.jc[0], ir, pr, b, alpha), nthreads);
+}
+
+//y = b+alpha*A*x over compressed columns, columns scatter into y
+void cscSpmv(int rows, int cols, const int* jc, const int* ir, const float* pr,
+    const float* x, float* y, const float* b, float alpha)
+{
+    for(int row=0; row<rows; row++){
+        y[row] = b ? b[row] : 0.0f;
+    }
+    for(int col=0; col<cols; col++){
+        float xc = alpha*x[col];
+        for(int i=jc[col]; i<jc[col+1]; i++){
+            y[ir[i]] += pr[i]*xc;
+        }
+    }
+}
+
+//largest absolute change between two iterates of length n
+float maxChange(const float* a, const float* b, int n){
+    float out=0;
+    for(int i=0; i<n; i++){
+        float d = fabs(a[i]-b[i]);
+        if(d>out) out=d;
+    }
+    return out;
+}
+
+//wall clock time in seconds, for solve deadlines
+double wallTime(){
+    boost::posix_time::ptime epoch (boost::gregorian::date(1970, 1, 1));
+    return (boost::posix_time::microsec_clock::universal_time()-epoch).total_microseconds()*1e-6;
+}
+
+//run iter jacobi sweeps starting at bufs[0], row blocks are swept in parallel on the pool
+//workers meet at a barrier after every sweep before the buffers are swapped
+//returns index of the buffer holding the result
+int runSweeps(const csr_mat& R, float* bufs[2], const vector<float>& invdg,
+    const vector<float>& lb, const vector<float>& ub, int iter, sweep_pool& pool, const float* b)
+{
+    if(R.rows==0) return 0;
+
+    boost::barrier sync (pool.size());
+    sweep_job job;
+    job.R = &R;
+    job.invdg = &invdg[0];
+    job.lb = &lb[0];
+    job.ub = &ub[0];
+    job.b = b;
+    job.bufs[0] = bufs[0];
+    job.bufs[1] = bufs[1];
+    job.blocks = getRowBlocks(R, pool.size());
+    job.iter = iter;
+    job.sync = &sync;
+
+    pool.run(boost::bind(sweepWorker, _1, boost::ref(job)));
+
+    return iter % 2;
+}
@@ -0,0 +1,65 @@
+#ifndef SWEEP_H
+#define SWEEP_H
+
+#include "csr.h"
+#include "parallel.h"
+
+using namespace std;
+
+//split n rows or chunks into nblocks contiguous blocks with balanced entries, starts holds
+//the n+1 entry offsets and each one also counts for its update. returns nblocks+1 block boundaries
+vector<int> getBlocks(const vector<int>& starts, int n, int nblocks);
+//split rows into nblocks contiguous blocks with balanced nonzeros
+//returns nblocks+1 block boundaries
+vector<int> getRowBlocks(const csr_mat& R, int nblocks);
+
+//fused row kernel, jacobi update of rows [begin,end) from in to out
+//out = clamp((in-(R*in+b)*invdg)/2, lb, ub), b may be NULL
+void sweepRows(int begin, int end, const float* in, float* out,
+    const int* jc, const int* ir, const float* pr, const float* b,
+    const float* invdg, const float* lb, const float* ub);
+
+//y = b+alpha*A*x for rows [begin,end) of compressed rows, b may be NULL or alias y
+void spmvRows(int begin, int end, const float* x, float* y,
+    const int* jc, const int* ir, const float* pr, const float* b, float alpha);
+
+//y = b+alpha*A*x over compressed rows, b may be NULL or alias y, x must not alias y.
+//rows are split over nthreads threads, 1 runs serially, 0 uses all hardware threads
+void csrSpmv(const csr_mat& A, const float* x, float* y, const float* b=NULL, float alpha=1.0f, int nthreads=1);
+
+//y = b+alpha*A*x over compressed columns as stored by eigen, b may be NULL or alias y,
+//x must not alias y. columns scatter into y, so it runs serially
+void cscSpmv(int rows, int cols, const int* jc, const int* ir, const float* pr,
+    const float* x, float* y, const float* b=NULL, float alpha=1.0f);
+
+//sweeps between convergence checks when a tolerance is set
+const int QP_CHECK_SWEEPS = 10;
+
+//largest absolute change between two iterates of length n
+float maxChange(const float* a, const float* b, int n);
+
+//wall clock time in seconds, for solve deadlines
+double wallTime();
+
+//outcome of the last solve
+struct qp_status{
+    //sweeps run, active set iterations for the direct solver
+    int sweeps;
+    //stopped at the deadline before running all sweeps or reaching the tolerance
+    bool timed_out;
+    //largest change of any unknown in the last sweep
+    float residual;
+    //the direct solver failed and the sweeps were run instead
+    bool failed;
+
+    qp_status():sweeps(0), timed_out(false), residual(0), failed(false){}
+};
+
+//run iter jacobi sweeps starting at bufs[0], row blocks are swept in parallel on the pool
+//workers meet at a barrier after every sweep before the buffers are swapped
+//b is added to R*in when given
+//returns index of the buffer holding the result
+int runSweeps(const csr_mat& R, float* bufs[2], const vector<float>& invdg,
+    const vector<float>& lb, const vector<float>& ub, int iter, sweep_pool& pool, const float* b=NULL);
+
+#endif
@@ -0,0 +1,128 @@
+
+#include "sym.h"
+#include "sweep.h"
+
+using namespace std;
+
+//get strict upper triangle of R
+csr_matPtr getUpper(const csr_mat& R){
+    csr_matPtr U (new csr_mat());
+    U->rows = R.rows;
+    U->cols = R.cols;
+    U->jc.reserve(R.rows+1);
+    U->ir.reserve(R.ir.size()/2);
+    U->pr.reserve(R.ir.size()/2);
+    U->jc.push_back(0);
+    for(int row=0; row<R.rows; row++){
+        for(int i=R.jc[row]; i<R.jc[row+1]; i++){
+            if(R.ir[i]<=row) continue;
+            U->ir.push_back(R.ir[i]);
+            U->pr.push_back(R.pr[i]);
+        }
+        U->jc.push_back(U->ir.size());
+    }
+    return U;
+}
+
+//scatter rows [begin,end) of U*x and U'*x into y
+void symScatterRows(int begin, int end, const float* __restrict__ x, float* __restrict__ y,
+    const int* __restrict__ jc, const int* __restrict__ ir, const float* __restrict__ pr)
+{
+    for(int row=begin; row<end; row++){
+        float xr = x[row];
+        float res = 0;
+        for(int i=jc[row]; i<jc[row+1]; i++){
+            res += pr[i]*x[ir[i]];
+            y[ir[i]] += pr[i]*xr;
+        }
+        y[row] += res;
+    }
+}
+
+//data shared by symmetric sweep workers
+struct sym_job{
+    const csr_mat* U;
+    const float* invdg;
+    const float* lb;
+    const float* ub;
+    float* bufs[2];
+    vector<int> blocks;
+    //private accumulator of each worker, covering rows [blocks[t], hi[t])
+    vector<vector<float> > acc;
+    vector<int> hi;
+    int iter;
+    boost::barrier* sync;
+};
+
+//scatter the row block of worker t, then update its rows from all accumulators
+void symWorker(int t, sym_job& job){
+    const csr_mat& U = *job.U;
+    const int* jc = &U.jc[0];
+    const int* ir = U.ir.empty() ? NULL : &U.ir[0];
+    const float* pr = U.pr.empty() ? NULL : &U.pr[0];
+    int begin = job.blocks[t];
+    int end = job.blocks[t+1];
+    //accumulator of worker t is indexed from its first row
+    float* y = job.acc[t].empty() ? NULL : &job.acc[t][0]-begin;
+
+    for(int it=0; it<job.iter; it++){
+        const float* in = job.bufs[it%2];
+        float* out = job.bufs[(it+1)%2];
+
+        for(int r=begin; r<job.hi[t]; r++) y[r]=0;
+        symScatterRows(begin, end, in, y, jc, ir, pr);
+        //every accumulator must be complete before rows are summed
+        job.sync->wait();
+
+        for(int row=begin; row<end; row++){
+            float res = 0;
+            //only earlier blocks scatter into this row
+            for(int s=0; s<=t; s++){
+                if(row<job.hi[s]) res += job.acc[s][row-job.blocks[s]];
+            }
+            res = (in[row]-res*job.invdg[row])*0.5f;
+            res = max(res, job.lb[row]);
+            res = min(res, job.ub[row]);
+            out[row] = res;
+        }
+        //out must be written and accumulators read before the next scatter
+        job.sync->wait();
+    }
+}
+
+//run iter jacobi sweeps starting at bufs[0] using the upper triangle U
+//returns index of the buffer holding the result
+int runSymSweeps(const csr_mat& U, float* bufs[2], const vector<float>& invdg,
+    const vector<float>& lb, const vector<float>& ub, int iter, sweep_pool& pool)
+{
+    if(U.rows==0) return 0;
+
+    boost::barrier sync (pool.size());
+    sym_job job;
+    job.U = &U;
+    job.invdg = &invdg[0];
+    job.lb = &lb[0];
+    job.ub = &ub[0];
+    job.bufs[0] = bufs[0];
+    job.bufs[1] = bufs[1];
+    job.blocks = getRowBlocks(U, pool.size());
+    job.iter = iter;
+    job.sync = &sync;
+
+    //a block scatters no further than its largest column
+    int nblocks = pool.size();
+    job.acc.resize(nblocks);
+    job.hi.resize(nblocks);
+    for(int t=0; t<nblocks; t++){
+        int hi = job.blocks[t+1];
+        for(int i=U.jc[job.blocks[t]]; i<U.jc[job.blocks[t+1]]; i++){
+            if(U.ir[i]+1>hi) hi=U.ir[i]+1;
+        }
+        job.hi[t] = hi;
+        job.acc[t].resize(hi-job.blocks[t]);
+    }
+
+    pool.run(boost::bind(symWorker, _1, boost::ref(job)));
+
+    return iter % 2;
+}
@@ -0,0 +1,24 @@
+#ifndef SYM_H
+#define SYM_H
+
+#include "csr.h"
+#include "parallel.h"
+
+using namespace std;
+
+//symmetric half storage of R
+//R = H'H - diag(H'H) is symmetric with a zero diagonal, so only the strict upper
+//triangle is kept in compressed rows. every entry (r,c) is applied twice:
+//gathered into row r and scattered into row c
+
+//get strict upper triangle of R
+csr_matPtr getUpper(const csr_mat& R);
+
+//run iter jacobi sweeps starting at bufs[0] using the upper triangle U
+//each worker scatters its row block into a private accumulator, the accumulators
+//are summed per row after a barrier, so no two threads write the same value
+//returns index of the buffer holding the result
+int runSymSweeps(const csr_mat& U, float* bufs[2], const vector<float>& invdg,
+    const vector<float>& lb, const vector<float>& ub, int iter, sweep_pool& pool);
+
+#endif
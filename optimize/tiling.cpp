@@ -0,0 +1,228 @@
+
+#include "tiling.h"
+#include "sweep.h"
+
+using namespace std;
+
+//position of each row in the interior or boundary list of the stencil
+struct stencil_lookup{
+    //true for interior rows
+    vector<bool> interior;
+    vector<int> pos;
+};
+
+//append neighbour rows of global row g to out
+void getNeighbours(stencil_argsPtr S, const stencil_lookup& L, int g, vector<int>& out){
+    int p = L.pos[g];
+    if(L.interior[g]){
+        out.insert(out.end(), S->nbrs.begin()+12*p, S->nbrs.begin()+12*(p+1));
+    }
+    else{
+        out.insert(out.end(), S->ir.begin()+S->jc[p], S->ir.begin()+S->jc[p+1]);
+    }
+}
+
+//build tile of rows [begin,end)
+//mark and local are scratch of length rows, mark[g]==stamp once g is in the tile
+void buildTile(stencil_argsPtr S, const stencil_lookup& L, int begin, int end, int k, int stamp,
+    const vector<float>& invdg, const vector<float>& lb, const vector<float>& ub,
+    vector<int>& mark, vector<int>& local, stencil_tile& T)
+{
+    //collect rows by hop distance
+    for(int g=begin; g<end; g++){
+        mark[g]=stamp;
+        local[g]=T.rows.size();
+        T.rows.push_back(g);
+    }
+    T.level.push_back(T.rows.size());
+    vector<int> nb;
+    int from=0;
+    for(int j=1; j<=k; j++){
+        int to = T.rows.size();
+        for(int l=from; l<to; l++){
+            nb.clear();
+            getNeighbours(S, L, T.rows[l], nb);
+            for(int n=0; n<nb.size(); n++){
+                if(mark[nb[n]]==stamp) continue;
+                mark[nb[n]]=stamp;
+                local[nb[n]]=T.rows.size();
+                T.rows.push_back(nb[n]);
+            }
+        }
+        from=to;
+        T.level.push_back(T.rows.size());
+    }
+
+    //local stencil of rows that are ever updated
+    int nupdate = T.level[k-1];
+    T.S.jc.push_back(0);
+    for(int l=0; l<nupdate; l++){
+        int g = T.rows[l];
+        int p = L.pos[g];
+        if(L.interior[g]){
+            T.S.interior.push_back(l);
+            for(int n=0; n<12; n++) T.S.nbrs.push_back(local[S->nbrs[12*p+n]]);
+        }
+        else{
+            T.S.boundary.push_back(l);
+            for(int i=S->jc[p]; i<S->jc[p+1]; i++){
+                T.S.ir.push_back(local[S->ir[i]]);
+                T.S.pr.push_back(S->pr[i]);
+            }
+            T.S.jc.push_back(T.S.ir.size());
+        }
+        T.invdg.push_back(invdg[g]);
+        T.lb.push_back(lb[g]);
+        T.ub.push_back(ub[g]);
+    }
+}
+
+//split the stencil into tiles of consecutive rows with k hop halos
+tiled_stencilPtr getTiledStencil(stencil_argsPtr S, const vector<float>& invdg,
+    const vector<float>& lb, const vector<float>& ub, int k, int tileRows)
+{
+    int nband = invdg.size();
+    stencil_lookup L;
+    L.interior.assign(nband, false);
+    L.pos.assign(nband, 0);
+    for(int p=0; p<S->interior.size(); p++){
+        L.interior[S->interior[p]]=true;
+        L.pos[S->interior[p]]=p;
+    }
+    for(int p=0; p<S->boundary.size(); p++){
+        L.pos[S->boundary[p]]=p;
+    }
+
+    tiled_stencilPtr T (new tiled_stencil());
+    T->rows = nband;
+    T->k = k;
+    int ntiles = (nband+tileRows-1)/tileRows;
+    T->tiles.resize(ntiles);
+    vector<int> mark (nband, -1);
+    vector<int> local (nband, 0);
+    long total=0;
+    for(int t=0; t<ntiles; t++){
+        int begin = t*tileRows;
+        int end = min(nband, begin+tileRows);
+        buildTile(S, L, begin, end, k, t, invdg, lb, ub, mark, local, T->tiles[t]);
+        total += T->tiles[t].rows.size();
+    }
+
+    cout<<"tiled stencil has "<<ntiles<<" tiles, "<<total<<" local rows for "<<nband<<" unknowns"<<endl;
+    return T;
+}
+
+//one sweep of the first limit local rows of a tile
+void tileSweep(const stencil_tile& T, int limit, const float* __restrict__ in, float* __restrict__ out){
+    const stencil_args& S = T.S;
+    int ninterior = S.interior.size();
+    const int* nb = S.nbrs.empty() ? NULL : &S.nbrs[0];
+    for(int i=0; i<ninterior; i++, nb+=12){
+        int row = S.interior[i];
+        //local rows are ordered by hop distance, so later rows are outside the limit too
+        if(row>=limit) break;
+        float near_ = in[nb[0]]+in[nb[1]]+in[nb[2]]+in[nb[3]]+in[nb[4]]+in[nb[5]];
+        float far_  = in[nb[6]]+in[nb[7]]+in[nb[8]]+in[nb[9]]+in[nb[10]]+in[nb[11]];
+        float res = STENCIL_NEAR*near_+STENCIL_FAR*far_;
+
+        res = (in[row]-res*(1.0f/STENCIL_DIAG))*0.5f;
+        res = max(res, T.lb[row]);
+        res = min(res, T.ub[row]);
+        out[row] = res;
+    }
+
+    int nboundary = S.boundary.size();
+    for(int i=0; i<nboundary; i++){
+        int row = S.boundary[i];
+        if(row>=limit) break;
+        float res = 0;
+        for(int j=S.jc[i]; j<S.jc[i+1]; j++)
+            res += S.pr[j]*in[S.ir[j]];
+
+        res = (in[row]-res*T.invdg[row])*0.5f;
+        res = max(res, T.lb[row]);
+        res = min(res, T.ub[row]);
+        out[row] = res;
+    }
+}
+
+//data shared by tile workers for one pass
+struct tile_job{
+    const tiled_stencil* T;
+    const float* in;
+    float* out;
+    //sweeps in this pass
+    int k;
+    //scratch buffers of each worker
+    vector<vector<float> >* scratch;
+    int nworkers;
+};
+
+//advance tiles t, t+nworkers, ... by k sweeps
+void tileWorker(int t, tile_job& job){
+    vector<float>& a = (*job.scratch)[2*t];
+    vector<float>& b = (*job.scratch)[2*t+1];
+    for(int i=t; i<job.T->tiles.size(); i+=job.nworkers){
+        const stencil_tile& T = job.T->tiles[i];
+        //gather the rows the k sweeps depend on
+        int nload = T.level[job.k];
+        for(int l=0; l<nload; l++) a[l] = job.in[T.rows[l]];
+
+        //step s is valid on rows within k-s hops
+        float* src = &a[0];
+        float* dst = &b[0];
+        for(int s=1; s<=job.k; s++){
+            tileSweep(T, T.level[job.k-s], src, dst);
+            swap(src, dst);
+        }
+
+        //scatter tile rows
+        for(int l=0; l<T.level[0]; l++) job.out[T.rows[l]] = src[l];
+    }
+}
+
+//quadratic programming optimization algorithm using the tiled stencil
+vector<float> runTiledStencilQP(tiled_stencilPtr T, const vector<float>& x, int iter, float tol,
+    sweep_pool& pool, double stop_time, qp_status* status)
+{
+    vector<float> cur (x);
+    vector<float> next (x.size(), 0);
+    if(status) *status = qp_status();
+    if(x.empty()) return cur;
+
+    int maxrows=0;
+    for(int i=0; i<T->tiles.size(); i++){
+        if(T->tiles[i].rows.size()>maxrows) maxrows=T->tiles[i].rows.size();
+    }
+    vector<vector<float> > scratch (2*pool.size(), vector<float>(maxrows));
+
+    int done=0;
+    while(done<iter){
+        tile_job job;
+        job.T = T.get();
+        job.in = &cur[0];
+        job.out = &next[0];
+        job.k = min(T->k, iter-done);
+        job.scratch = &scratch;
+        job.nworkers = pool.size();
+        pool.run(boost::bind(tileWorker, _1, boost::ref(job)));
+
+        cur.swap(next);
+        done += job.k;
+        if(tol>0 && maxChange(&cur[0], &next[0], cur.size())<tol){
+            cout<<"converged after "<<done<<" sweeps"<<endl;
+            break;
+        }
+        if(stop_time>0 && wallTime()>=stop_time && done<iter){
+            if(status) status->timed_out = true;
+            cout<<"stopped at deadline after "<<done<<" sweeps"<<endl;
+            break;
+        }
+    }
+    if(status){
+        //the residual is the change over the last pass of up to k sweeps
+        status->sweeps = done;
+        status->residual = done>0 ? maxChange(&cur[0], &next[0], cur.size()) : 0;
+    }
+    return cur;
+}
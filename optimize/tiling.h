@@ -0,0 +1,48 @@
+#ifndef TILING_H
+#define TILING_H
+
+#include "stencil.h"
+#include "parallel.h"
+
+using namespace std;
+
+//rows per tile of the temporally blocked stencil, sized so a tile with its halo stays in cache
+const int STENCIL_TILE_ROWS = 16384;
+
+//one tile of the temporally blocked stencil
+//holds the tile rows and every row within k hops of them, numbered locally and
+//ordered by hop distance, so the rows valid after step s are a prefix of rows
+struct stencil_tile{
+    //global rows, tile rows first
+    vector<int> rows;
+    //level[j] is the number of local rows within j hops of the tile, j=0..k
+    vector<int> level;
+    //stencil of local rows within k-1 hops, in local indices
+    stencil_args S;
+    //inverse diagonal and bounds of local rows within k-1 hops
+    vector<float> invdg;
+    vector<float> lb;
+    vector<float> ub;
+};
+
+//stencil split into overlapping tiles that are advanced k sweeps at a time
+struct tiled_stencil{
+    int rows;
+    int k;
+    vector<stencil_tile> tiles;
+};
+typedef boost::shared_ptr<tiled_stencil> tiled_stencilPtr;
+
+//split the stencil into tiles of consecutive rows with k hop halos
+tiled_stencilPtr getTiledStencil(stencil_argsPtr S, const vector<float>& invdg,
+    const vector<float>& lb, const vector<float>& ub, int k, int tileRows=STENCIL_TILE_ROWS);
+
+//quadratic programming optimization algorithm using the tiled stencil
+//every pass advances each tile up to k sweeps in its own scratch buffers, tiles run in parallel.
+//stops early once a pass changes no unknown by more than tol, 0 runs all iter sweeps.
+//stops after the pass that reaches the wallTime() stop_time when it is set.
+//the outcome is written to status when given
+vector<float> runTiledStencilQP(tiled_stencilPtr T, const vector<float>& x, int iter, float tol,
+    sweep_pool& pool, double stop_time=0, qp_status* status=NULL);
+
+#endif
@@ -1,5 +1,6 @@
 
 #include "primeqp_conf.h"
+#include "primeqp.h"
 
 namespace conf
 {
@@ -9,122 +10,73 @@ using namespace std;
 //linear indexing is used throughout
 //linear index = z*num_x*num_y + y*num_x + x;
 
-//apply confidences to all voxels using gaussian distribution on distance field
-gridPtr applyConfidence(gridPtr confGrid){
-    gridPtr margin = copyGrid(confGrid);
-    gridPtr margin_ind = copyGrid(confGrid);
-    //set all volume points to 0 in margin
-    for(int i=0; i<margin->dims[0]; i++){
-        for(int j=0; j<margin->dims[1]; j++){
-            for(int k=0; k<margin->dims[2]; k++){
-                if((*margin)[i][j][k]>-1.0){
-                    (*margin)[i][j][k]=0.0;
+//apply confidences to band unknowns using gaussian distribution on distance field
+vector<float> applyConfidence(gridPtr confGrid, const vector<int> &indexes){
+    //distance to and index of closest voxel holding a confidence
+    vector<float> sqdist;
+    vector<int> nearest;
+    getEDT(getConfidenceSites(confGrid), sqdist, nearest);
+
+    //gaussian of the band unknowns only, evaluated as one array
+    //mean=0, variance=1
+    int nband = indexes.size();
+    Eigen::ArrayXf d2 (nband);
+    for(int i=0; i<nband; i++){
+        d2[i] = nearest[indexes[i]]>=0 ? sqdist[indexes[i]] : EDT_FAR;
+    }
+    Eigen::ArrayXf gauss = (d2*-0.5f).exp();
+
+    vector<float> out (nband, 0.0f);
+    for(int i=0; i<nband; i++){
+        int site = nearest[indexes[i]];
+        if(site<0) continue;
+        float conf = (*confGrid)(site)*gauss[i];
+        if(conf>=0.001) out[i] = conf;
+    }
+    return out;
+}
+
+//binary grid with 0 at voxels holding a confidence
+gridPtr getConfidenceSites(gridPtr confGrid){
+    gridPtr sites (new grid(confGrid->dims, confGrid->scale, confGrid->shift, confGrid->pad));
+    for(int i=0; i<sites->dims[0]; i++){
+        for(int j=0; j<sites->dims[1]; j++){
+            for(int k=0; k<sites->dims[2]; k++){
+                if((*confGrid)[i][j][k]>-1.0){
+                    (*sites)[i][j][k]=0.0;
                 }
                 else{
-                    (*margin)[i][j][k]=1.0;
+                    (*sites)[i][j][k]=1.0;
                 }
             }
         }
     }
-    //get distance field
-    margin = getsqrt(getsqdist(margin));
-    //get distance field indexes
-    margin_ind = getsqdist_index(margin);
-
-
-    //apply confidences based on gaussian
-    //mean=0, variance=2
-    for(int i=0; i<margin->dims[0]; i++){
-        for(int j=0; j<margin->dims[1]; j++){
-            for(int k=0; k<margin->dims[2]; k++){
-                //get confidence value of closest point
-                float conf = (*confGrid)((int)(*margin_ind)[i][j][k]);
-                //get new confidence value using gaussian
-                float dist = (*margin)[i][j][k];
-                float var = 1.0;
-                float exp = -dist*dist/(2.0*var);
-                float gauss = pow(2.71828f,exp);
-                (*margin)[i][j][k] = conf*gauss;
-                if((*margin)[i][j][k]<0.001) (*margin)[i][j][k]=0.0;
-            }
-        }
-    }
-
-    return margin;
-}
-
-//solve for inverse of sparse matrix
-SparseMatrixPtr getInverse(SparseMatrixPtr in){
-    Eigen::SparseMatrix<float> I(in->cols(),in->cols());
-    I.setIdentity();
-
-    Eigen::SimplicialLDLT<Eigen::SparseMatrix<float> > solver;
-    solver.compute(*in);
-    SparseMatrixPtr out (new Eigen::SparseMatrix<float> (solver.solve(I)));
-
-    return out;
+    return sites;
 }
 
-//create diagonal confidence matrix
-SparseMatrixPtr getCMat(gridPtr confGrid, const vector<int> &indexes){
-    //create triplet list
+//create diagonal confidence matrix from confidences of band unknowns
+SparseMatrixPtr getCMat(const vector<float> &conf){
     vector<Eigen::Triplet<float> > tripletList;
-    tripletList.reserve(indexes.size());
-    for(int i=0; i<indexes.size(); i++){
-        float conf = (*confGrid)(indexes[i]);
-        tripletList.push_back(Eigen::Triplet<float>(i,i,conf));
+    tripletList.reserve(conf.size());
+    for(int i=0; i<conf.size(); i++){
+        tripletList.push_back(Eigen::Triplet<float>(i,i,conf[i]));
     }
-    //create sparse matrix
-    SparseMatrixPtr C (new Eigen::SparseMatrix<float>(indexes.size(),indexes.size()));
+    SparseMatrixPtr C (new Eigen::SparseMatrix<float>(conf.size(),conf.size()));
     C->setFromTriplets(tripletList.begin(), tripletList.end());
     return C;
 }
 
-//get triplet list from sparse matrix
-vector<Eigen::Triplet<float> > getTriplets(SparseMatrixPtr in){
-    vector<Eigen::Triplet<float> > out;
-    out.reserve(in->nonZeros());
-    for(int k=0; k<in->outerSize(); k++){
-        for(Eigen::SparseMatrix<float>::InnerIterator it(*in,k); it; ++it){
-            out.push_back(Eigen::Triplet<float>(it.row(),it.col(),it.value()));
-        }
-    }
-    return out;
-}
-//function for comparing triplets by row major order
-bool compRow(const Eigen::Triplet<float> &in1, const Eigen::Triplet<float> &in2){
-    if(in1.row()<in2.row()) return true;
-    else if(in1.row()==in2.row()){
-        return (in1.col()<in2.col());
-    }
-    else return false;
-}
-//reorder triplets by row major order
-void sortByRow(vector<Eigen::Triplet<float> > &in){
-    bool (*comp)(const Eigen::Triplet<float> &in1, const Eigen::Triplet<float> &in2);
-    comp = &compRow;
-    sort(in.begin(), in.end(), comp);
-}
 //function for multiplying sparse matrix by vector
 vector<float> multiplyMatVec(SparseMatrixPtr mat, vector<float> &vec){
     if(mat->cols()!=vec.size()){
         cerr<<"Matrix and vector sizes must match"<<endl;
         return vec;
     }
-    vector<float> out (vec.size(), 0.0f);
-    vector<Eigen::Triplet<float> > trips = getTriplets(mat);
-    sortByRow(trips);
-    int row=0;
-    float val=0.0f;
-    for(int i=0; i<trips.size(); i++){
-        if(trips[i].row()>row){
-            out[row] = val;
-            val=0.0f;
-            row=trips[i].row();
-        }
-        val+=(trips[i].value()*vec[trips[i].col()]);
-    }
-    out[row] = val;
+    vector<float> out (mat->rows(), 0.0f);
+    if(out.empty() || vec.empty()) return out;
+    //product straight from the compressed columns
+    mat->makeCompressed();
+    cscSpmv(mat->rows(), mat->cols(), mat->outerIndexPtr(), mat->innerIndexPtr(), mat->valuePtr(), &vec[0], &out[0]);
     return out;
 }
 //function for adding two vectors
@@ -151,198 +103,152 @@ vector<float> subtractVec(vector<float> &in1, const vector<float> &in2){
     return out;
 }
 
-//function for getting z vector
-vector<float> getZVec(SparseMatrixPtr R, SparseMatrixPtr C, vector<float> &x_0){
-    SparseMatrixPtr M (new Eigen::SparseMatrix<float>((*R)+(*C)));
-    cout<<"computing inverse"<<endl;
-    *M = (*getInverse(M))*(*C);
-    cout<<"inverse computed"<<endl;
-    M->prune(0,0);
-    return multiplyMatVec(M, x_0);
+ZVecCache::ZVecCache(int pcg_size_in){
+    pcg_size=pcg_size_in;
+    ldlt_key=0;
+    z_key=0;
 }
 
+//unknowns from which getZVec runs conjugate gradients
+int ZVecCache::pcgSize() const{
+    return pcg_size;
+}
 
-
-//**********************************************************************
-
-//make H matrix
-SparseMatrixPtr getHMat(gridPtr tightBand, gridPtr indexMap){
-    vector<int> indexes = findIndexes(tightBand);
-    //set ntight
-    int ntight = indexes.size();
-    //get subscript vector for indexes
-    Eigen::Vector3i subs[ntight];
-    for(int i=0; i<ntight; i++){
-        subs[i] = tightBand->ind2sub(indexes[i]);
-    }
-
-    //create Hi
-    vector<int> Hi (ntight*9, 0);
-    int index=0;
-    for(int i=0; i<3; i++){
-        for(int j=0; j<3; j++){
-            for(int k=0; k<ntight; k++){
-                Hi[index] = k+ntight*i;
-                index++;
-            }
-        }
-    }
-
-    //create Hj
-    vector<int> Hj (ntight*9, 0);
-    index=0;
-    //add mid
-    for(int i=0; i<ntight; i++){
-        Hj[index] = (*indexMap)[subs[i][0]][subs[i][1]][subs[i][2]];
-        index++;
-    }
-    //add left
-    for(int i=0; i<ntight; i++){
-        Hj[index] = (*indexMap)[subs[i][0]-1][subs[i][1]][subs[i][2]];
-        index++;
-    }
-    //add right
-    for(int i=0; i<ntight; i++){
-        Hj[index] = (*indexMap)[subs[i][0]+1][subs[i][1]][subs[i][2]];
-        index++;
-    }
-    //add mid
-    for(int i=0; i<ntight; i++){
-        Hj[index] = (*indexMap)[subs[i][0]][subs[i][1]][subs[i][2]];
-        index++;
-    }
-    //add top
-    for(int i=0; i<ntight; i++){
-        Hj[index] = (*indexMap)[subs[i][0]][subs[i][1]-1][subs[i][2]];
-        index++;
-    }
-    //add bottom
-    for(int i=0; i<ntight; i++){
-        Hj[index] = (*indexMap)[subs[i][0]][subs[i][1]+1][subs[i][2]];
-        index++;
+//solve M*z = rhs, analysing the pattern of M only when its hash differs from the last one
+vector<float> ZVecCache::factorSolve(const Eigen::SparseMatrix<float> &M, vector<float> &rhs, size_t key){
+    size_t pattern = key==0 ? 0 : getPatternKey(M);
+    if(!ldlt || pattern==0 || pattern!=ldlt_key){
+        cout<<"analysing R+C"<<endl;
+        ldlt.reset(new Eigen::SimplicialLDLT<Eigen::SparseMatrix<float> >());
+        ldlt->analyzePattern(M);
+        ldlt_key = pattern;
     }
-    //add mid
-    for(int i=0; i<ntight; i++){
-        Hj[index] = (*indexMap)[subs[i][0]][subs[i][1]][subs[i][2]];
-        index++;
-    }
-    //add front
-    for(int i=0; i<ntight; i++){
-        Hj[index] = (*indexMap)[subs[i][0]][subs[i][1]][subs[i][2]-1];
-        index++;
-    }
-    //add back
-    for(int i=0; i<ntight; i++){
-        Hj[index] = (*indexMap)[subs[i][0]][subs[i][1]][subs[i][2]+1];
-        index++;
-    }
-
-    //create Hs
-    vector<int> Hs (ntight*9, 1);
-    index=0;
-    for(int i=0; i<3; i++){
-        for(int j=0; j<ntight; j++){
-            Hs[index]=-2;
-            index++;
-        }
-        for(int j=0; j<ntight*2; j++){
-            Hs[index]=1;
-            index++;
-        }
+    cout<<"factoring R+C"<<endl;
+    ldlt->factorize(M);
+    if(ldlt->info()!=Eigen::Success){
+        cerr<<"Factorization of R+C failed"<<endl;
+        ldlt.reset();
+        ldlt_key = 0;
+        return vector<float>(rhs.size(), 0.0f);
     }
+    cout<<"R+C factored"<<endl;
+    Eigen::Map<Eigen::VectorXf> b (&rhs[0], rhs.size());
+    Eigen::VectorXf out = ldlt->solve(b);
+    return vector<float>(out.data(), out.data()+out.size());
+}
 
+//last z solved for key, empty if there is none
+vector<float> ZVecCache::getZ(size_t key) const{
+    if(key==0 || key!=z_key) return vector<float>();
+    return z;
+}
 
-    //create initial H
-    //get max value of Hj
-    int maxj = 0;
-    for(int i=0; i<Hj.size(); i++){
-        if (Hj[i]>maxj) maxj=Hj[i];
-    }
-    //create triplets from Hi,Hj,Hs
-    vector<Eigen::Triplet<float> > tripletList;
-    tripletList.reserve(Hi.size());
-    for(int i=0; i<Hi.size(); i++){
-        tripletList.push_back(Eigen::Triplet<float>(Hi[i],Hj[i],(float)Hs[i]));
-    }
+//keep z solved for key
+void ZVecCache::setZ(const vector<float> &z_in, size_t key){
+    z = z_in;
+    z_key = key;
+}
 
-    SparseMatrixPtr H (new Eigen::SparseMatrix<float>(3*ntight, maxj+1));
-    H->setFromTriplets(tripletList.begin(), tripletList.end());
+//drop the factorization and z
+void ZVecCache::release(){
+    ldlt.reset();
+    ldlt_key=0;
+    vector<float>().swap(z);
+    z_key=0;
+}
 
-    *H = Eigen::SparseMatrix<float>(H->transpose())*(*H);
-    return H;
+//hash of the band index list and the grid dims, never 0
+size_t getBandKey(const vector<int> &indexes, const Eigen::Vector3i &dims){
+    size_t h = 14695981039346656037ULL;
+    for(int i=0; i<indexes.size(); i++) h = (h^(size_t)indexes[i])*1099511628211ULL;
+    h = (h^(size_t)indexes.size())*1099511628211ULL;
+    for(int a=0; a<3; a++) h = (h^(size_t)dims[a])*1099511628211ULL;
+    return h==0 ? 1 : h;
 }
 
+//hash of the compressed sparse pattern of M, never 0
+size_t getPatternKey(const Eigen::SparseMatrix<float> &M){
+    size_t h = 14695981039346656037ULL;
+    const int* outer = M.outerIndexPtr();
+    const int* inner = M.innerIndexPtr();
+    for(int i=0; i<=M.outerSize(); i++) h = (h^(size_t)outer[i])*1099511628211ULL;
+    for(int i=0; i<M.nonZeros(); i++) h = (h^(size_t)inner[i])*1099511628211ULL;
+    h = (h^(size_t)M.rows())*1099511628211ULL;
+    return h==0 ? 1 : h;
+}
 
+//solve M*z = rhs from a sparse factorization of M
+vector<float> factorZVec(const Eigen::SparseMatrix<float> &M, vector<float> &rhs){
+    ZVecCache cache;
+    return cache.factorSolve(M, rhs, 0);
+}
 
-//get lower bound vector
-vector<float> getlb(gridPtr margin, gridPtr volume, const vector<int> &indexes){
-    //make a copy of margin
-    //set values outside of volume to -1000
-    gridPtr lbnd (new grid(margin->dims, margin->t_));
-    for(int i=0; i<lbnd->dims[0]; i++){
-        for(int j=0; j<lbnd->dims[1]; j++){
-            for(int k=0; k<lbnd->dims[2]; k++){
-                if((*volume)[i][j][k]==0.0){
-                    (*lbnd)[i][j][k]=-1000.0;
-                }
-                else{
-                    (*lbnd)[i][j][k]=(*margin)[i][j][k];
-                }
-            }
-        }
+//function for getting z vector
+//solves (R+C)z = C x_0 by factorization for small bands and conjugate gradients for large ones
+vector<float> getZVec(SparseMatrixPtr R, SparseMatrixPtr C, vector<float> &x_0, int nthreads,
+    float tol, const vector<float> &z_0, ZVecCache *cache, size_t key)
+{
+    if(x_0.empty()) return x_0;
+    Eigen::SparseMatrix<float> M = (*R)+(*C);
+    M.makeCompressed();
+    //single right hand side C*x_0
+    vector<float> rhs = multiplyMatVec(C, x_0);
+    if(M.rows()<(cache ? cache->pcgSize() : ZVEC_PCG_SIZE)){
+        if(cache) return cache->factorSolve(M, rhs, key);
+        return factorZVec(M, rhs);
     }
 
-    //create lb vector using linear indexes
-    vector<float> lb (indexes.size(), 0);
-    for(int i=0; i<lb.size(); i++){
-        lb[i] = (*lbnd)(indexes[i]);
+    //M is symmetric, so its compressed columns are its compressed rows
+    csr_mat A;
+    A.rows = M.rows();
+    A.cols = M.cols();
+    A.jc.assign(M.outerIndexPtr(), M.outerIndexPtr()+A.rows+1);
+    A.ir.assign(M.innerIndexPtr(), M.innerIndexPtr()+M.nonZeros());
+    A.pr.assign(M.valuePtr(), M.valuePtr()+M.nonZeros());
+
+    vector<float> z (x_0.size(), 0.0f);
+    if(z_0.size()==z.size()) z = z_0;
+    else if(cache){
+        vector<float> prev = cache->getZ(key);
+        if(prev.size()==z.size()) z = prev;
     }
-
-    return lb;
-}
-//get upper bound vector
-vector<float> getub(gridPtr margin, gridPtr volume, const vector<int> &indexes){
-    //make a copy of negative margin
-    //set values inside of volume to 1000
-    gridPtr ubnd (new grid(margin->dims, margin->t_));
-    for(int i=0; i<ubnd->dims[0]; i++){
-        for(int j=0; j<ubnd->dims[1]; j++){
-            for(int k=0; k<ubnd->dims[2]; k++){
-                if((*volume)[i][j][k]==1.0){
-                    (*ubnd)[i][j][k]=1000.0;
-                }
-                else{
-                    (*ubnd)[i][j][k]=-(*margin)[i][j][k];
-                }
-            }
-        }
+    sweep_pool pool (nthreads);
+    int iter = runPCG(A, rhs, z, tol, PCG_MAX_ITER, pool);
+    if(iter<0){
+        cerr<<"Conjugate gradients broke down, factoring R+C"<<endl;
+        if(cache) return cache->factorSolve(M, rhs, key);
+        return factorZVec(M, rhs);
     }
-
-    //create ub vector using linear indexes
-    vector<float> ub (indexes.size(), 0);
-    for(int i=0; i<ub.size(); i++){
-        ub[i] = (*ubnd)(indexes[i]);
+    if(iter==PCG_MAX_ITER){
+        cerr<<"Conjugate gradients stopped before reaching tolerance"<<endl;
     }
-
-    return ub;
+    cout<<"z solved in "<<iter<<" conjugate gradient iterations"<<endl;
+    if(cache) cache->setZ(z, key);
+    return z;
 }
 
+
+
+//**********************************************************************
+
 //prepare quadratic program arguments
-qp_argsPtr primeQP(gridPtr confGrid, gridPtr volume, gridPtr margin, bandsPtr bnds){
+qp_argsPtr primeQP(gridPtr confGrid, gridPtr volume, gridPtr margin, bandsPtr bnds, int nthreads,
+    ZVecCache *cache)
+{
     //create indexes of band
     vector<int> indexes = findIndexes(bnds->band);
     //create index map
     gridPtr indexMap = getIndexMap(bnds->band, indexes);
     //create H matrix
-    SparseMatrixPtr H = getHMat(bnds->tight_band, indexMap);
+    SparseMatrixPtr H = ::getHMat(bnds->tight_band, indexMap);
     //H matrix has size nband x nband
 
     //create C matrix
-    SparseMatrixPtr C = getCMat(applyConfidence(confGrid), indexes);
+    SparseMatrixPtr C = getCMat(applyConfidence(confGrid, indexes));
 
     //create upper and lower bounds
-    vector<float> lb_ = getlb(margin, volume, indexes);
-    vector<float> ub_ = getub(margin, volume, indexes);
+    vector<float> lb_ = ::getlb(margin, volume, indexes);
+    vector<float> ub_ = ::getub(margin, volume, indexes);
     //lb_ and ub_ have length nband
 
     //get invdg
@@ -360,12 +266,6 @@ qp_argsPtr primeQP(gridPtr confGrid, gridPtr volume, gridPtr margin, bandsPtr bn
     dg->setFromTriplets(diag_trips.begin(), diag_trips.end());
     SparseMatrixPtr invdg (new Eigen::SparseMatrix<float>(H->rows(), H->cols()));
     invdg->setFromTriplets(invdiag_trips.begin(), invdiag_trips.end());
-    *H = ((*H)-(*dg));
-    H->prune(0,0);
-
-    //normalize H
-    *H = ((*H)*(*invdg));
-    H->prune(0,0);
 
     //create x vector
     vector<float> x_ (H->rows(),0);
@@ -376,9 +276,23 @@ qp_argsPtr primeQP(gridPtr confGrid, gridPtr volume, gridPtr margin, bandsPtr bn
     }
 
     //create z vector
-    vector<float> z_ = getZVec(H, C, x_);
+    //the sweeps solve (I+invdg*R+C)y=0 for y=x-z, so z solves (I+invdg*R+C)z=C*x_,
+    //scaled by dg this is the symmetric system (H'H+dg*C)z=dg*C*x_
+    SparseMatrixPtr dgC (new Eigen::SparseMatrix<float>((*dg)*(*C)));
+    size_t key = cache ? getBandKey(indexes, bnds->band->dims) : 0;
+    vector<float> z_ = getZVec(H, dgC, x_, nthreads, ZVEC_PCG_TOL, vector<float>(), cache, key);
 
     vector<float> x_in = subtractVec(x_, z_);
+    //bound y=x-z so that x stays within lb_ and ub_
+    lb_ = subtractVec(lb_, z_);
+    ub_ = subtractVec(ub_, z_);
+
+    *H = ((*H)-(*dg));
+    H->prune(0,0);
+
+    //normalize H
+    *H = ((*H)*(*invdg));
+    H->prune(0,0);
 
     //create M matrix
     *H = ((*H)+(*C));
@@ -393,6 +307,9 @@ qp_argsPtr primeQP(gridPtr confGrid, gridPtr volume, gridPtr margin, bandsPtr bn
     out->z = z_;
     //out->z = x_;
     out->iter = 500;
+    out->tol = 0;
+    out->deadline = 0;
+    out->threads = 0;
 
     cout<<"quadratic program ready"<<endl;
     return out;
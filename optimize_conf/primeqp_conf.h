@@ -6,6 +6,9 @@
 #include <Eigen/SparseCholesky>
 
 #include "narrowBand.h"
+#include "edt.h"
+#include "sweep.h"
+#include "pcg.h"
 
 namespace conf
 {
@@ -17,21 +20,15 @@ using namespace std;
 
 typedef boost::shared_ptr<Eigen::SparseMatrix<float> > SparseMatrixPtr;
 
-//apply confidences to all voxels using gaussian distribution on distance field
-gridPtr applyConfidence(gridPtr confGrid);
+//apply confidences to band unknowns using gaussian distribution on distance field
+//the distance transform runs once over the grid, the gaussian only for the unknowns of indexes
+vector<float> applyConfidence(gridPtr confGrid, const vector<int> &indexes);
+//binary grid with 0 at voxels holding a confidence
+gridPtr getConfidenceSites(gridPtr confGrid);
 
-//solve for inverse of sparse matrix
-SparseMatrixPtr getInverse(SparseMatrixPtr in);
+//create diagonal confidence matrix from confidences of band unknowns
+SparseMatrixPtr getCMat(const vector<float> &conf);
 
-//create diagonal confidence matrix
-SparseMatrixPtr getCMat(gridPtr confGrid, const vector<int>& indexes);
-
-//get triplet list from sparse matrix
-vector<Eigen::Triplet<float> > getTriplets(SparseMatrixPtr in);
-//function for comparing triplets by row major order
-bool compRow(const Eigen::Triplet<float> &in1, const Eigen::Triplet<float> &in2);
-//reorder triplets by row major order
-void sortByRow(vector<Eigen::Triplet<float> > &in);
 //function for multiplying sparse matrix by vector
 vector<float> multiplyMatVec(SparseMatrixPtr mat, vector<float> &vec);
 //function for adding two vectors
@@ -39,8 +36,63 @@ vector<float> addVec(vector<float> &in1, const vector<float> &in2);
 //function for subtracting two vectors
 vector<float> subtractVec(vector<float> &in1, const vector<float> &in2);
 
+//unknowns from which getZVec uses conjugate gradients instead of a sparse factorization
+const int ZVEC_PCG_SIZE = 1000;
+//relative residual at which the conjugate gradient z solve stops
+const float ZVEC_PCG_TOL = 1e-6;
+
+//state of getZVec kept between solves of the same band
+//the symbolic factorization (ordering and elimination tree) is reused while the hash of the
+//sparse pattern of R+C is unchanged and only the numeric factorization is redone.
+//the last z of the same band key warm starts conjugate gradients.
+//the factorization is only used below pcg_size unknowns, so a caller sweeping parameters over a
+//large band raises it to keep factoring instead of running conjugate gradients
+class ZVecCache{
+private:
+    //unknowns from which getZVec runs conjugate gradients
+    int pcg_size;
+    boost::shared_ptr<Eigen::SimplicialLDLT<Eigen::SparseMatrix<float> > > ldlt;
+    //pattern key the symbolic factorization was computed for, 0 if none
+    size_t ldlt_key;
+    //band key of z, 0 if none
+    size_t z_key;
+    vector<float> z;
+
+public:
+    ZVecCache(int pcg_size_in=ZVEC_PCG_SIZE);
+
+    //unknowns from which getZVec runs conjugate gradients
+    int pcgSize() const;
+
+    //solve M*z = rhs, analysing the pattern of M only when its hash differs from the last one.
+    //key 0 always analyses
+    vector<float> factorSolve(const Eigen::SparseMatrix<float> &M, vector<float> &rhs, size_t key);
+
+    //last z solved for key, empty if there is none
+    vector<float> getZ(size_t key) const;
+    //keep z solved for key
+    void setZ(const vector<float> &z_in, size_t key);
+
+    //drop the factorization and z
+    void release();
+};
+
+//hash of the band index list and the grid dims, never 0
+size_t getBandKey(const vector<int> &indexes, const Eigen::Vector3i &dims);
+//hash of the compressed sparse pattern of M, never 0
+size_t getPatternKey(const Eigen::SparseMatrix<float> &M);
+
+//solve M*z = rhs from a sparse factorization of M
+vector<float> factorZVec(const Eigen::SparseMatrix<float> &M, vector<float> &rhs);
+
 //function for getting z vector
-vector<float> getZVec(SparseMatrixPtr R, SparseMatrixPtr C, vector<float> &x_0);
+//solves (R+C)z = C x_0, R symmetric and C diagonal. below ZVEC_PCG_SIZE unknowns, or the
+//pcgSize() of a given cache, R+C is factored, from there jacobi preconditioned conjugate
+//gradients on nthreads threads run to tol, starting
+//from z_0 when it is given. a breakdown of conjugate gradients falls back to the factorization.
+//with a cache, the factorization and the starting z of the band with the given key are reused
+vector<float> getZVec(SparseMatrixPtr R, SparseMatrixPtr C, vector<float> &x_0, int nthreads=0,
+    float tol=ZVEC_PCG_TOL, const vector<float> &z_0=vector<float>(), ZVecCache *cache=NULL, size_t key=0);
 
 struct qp_args{
     SparseMatrixPtr M;
@@ -49,19 +101,19 @@ struct qp_args{
     vector<float> x;
     vector<float> z;
     int iter;
+    //stop once a sweep changes no unknown by more than tol, 0 runs all iter sweeps
+    float tol;
+    //seconds allowed for the sweeps, 0 for no limit
+    float deadline;
+    //worker threads for the sweeps, 0 uses all hardware threads
+    int threads;
 };
 typedef boost::shared_ptr<qp_args> qp_argsPtr;
 
-//make H matrix
-SparseMatrixPtr getHMat(gridPtr tightBand, gridPtr indexMap);
-
-//get lower bound vector
-vector<float> getlb(gridPtr margin, gridPtr volume, const vector<int> &indexes);
-//get upper bound vector
-vector<float> getub(gridPtr margin, gridPtr volume, const vector<int> &indexes);
-
 //prepare quadratic program arguments
-qp_argsPtr primeQP(gridPtr confGrid, gridPtr volume, gridPtr margin, bandsPtr bnds);
+//nthreads is used by the z solve of large bands, cache keeps its state between calls
+qp_argsPtr primeQP(gridPtr confGrid, gridPtr volume, gridPtr margin, bandsPtr bnds, int nthreads=0,
+    ZVecCache *cache=NULL);
 
 }
 
@@ -7,103 +7,45 @@ namespace conf
 using namespace std;
 using namespace conf;
 
-//more formatting for rapid algorithm
-//takes advantage of sparseness
-vector<int> getIr(SparseMatrixPtr R){
-    vector<int> ir (R->nonZeros());
-    int count=0;
-    for (int k=0; k<R->outerSize(); ++k){
-        for (Eigen::SparseMatrix<float>::InnerIterator it(*R,k); it; ++it){
-            ir[count] = it.row();
-            count++;
-        }
-    }
-    return ir;
-
-}
-vector<int> getJc(SparseMatrixPtr R){
-    vector<int> jc ((R->cols())+1);
-    jc[0]=0;
-    int sum=0;
-    for (int k=0; k<R->outerSize(); ++k){
-        for (Eigen::SparseMatrix<float>::InnerIterator it(*R,k); it; ++it){
-            sum++;
-        }
-        jc[k+1]=sum;
-    }
-    return jc;
-}
-vector<float> getPr(SparseMatrixPtr R){
-    vector<float> pr (R->nonZeros(), 0);
-    int count=0;
-    for (int k=0; k<R->outerSize(); ++k){
-        for (Eigen::SparseMatrix<float>::InnerIterator it(*R,k); it; ++it){
-            pr[count]=it.value();
-            count++;
-        }
-    }
-    return pr;
-}
-
-//row increment
-void doStep(int row, const vector<float> &in, vector<float> &out,
-    const vector<int> &ir, const vector<int> &jc, const vector<float> &pr,
-    const vector<float> &lb, const vector<float> &ub)
-{
-    float res = 0;
-    int start = jc[row];
-    int end   = jc[row+1];
-    int i;
-
-    for(i = start; i < end; i++){
-        res +=  pr[i]*in[ir[i]];
-    }
-
-    res = (in[row]-res)*0.5;
-    if(res < lb[row]) res = lb[row];
-    if(res > ub[row]) res = ub[row];
-    out[row] = res;
-}
-
 //quadratic programming optimization algorithm
 vector<float> runQP(qp_argsPtr args){
-    //get ir and jc
-    vector<int> ir = getIr(args->M);
-    vector<int> jc = getJc(args->M);
-    vector<float> pr = getPr(args->M);
-
-    int size = args->M->rows();
-
-    vector<float>* buf1 = new vector<float>(args->x);
-    vector<float>* buf2 = new vector<float>(size, 0);
-    vector<float>* in;
-    vector<float>* out;
-
-    //perform algorithm
-    for(int i = 0; i < args->iter; i++){
-        if(i % 2){
-            in = buf2;
-            out = buf1;
-        }
-        else{
-            in = buf1;
-            out = buf2;
-        }
-
-        for(int r = 0; r < size; r++){
-            doStep(r, *in, *out, ir, jc, pr, args->lb, args->ub);
-        }
-    }
+    QPSolver solver;
+    return runQP(args, solver);
+}
+//quadratic programming optimization algorithm using a reusable solver
+vector<float> runQP(qp_argsPtr args, QPSolver &solver){
+    //the compressed columns of M = (H'H-dg)*invdg+C are swept as rows, which applies
+    //its transpose invdg*(H'H-dg)+C, so the sweeps run with a unit inverse diagonal
+    ::qp_argsPtr sweep_args (new ::qp_args());
+    sweep_args->R = args->M;
+    sweep_args->invdg.assign(args->x.size(), 1.0f);
+    sweep_args->lb = args->lb;
+    sweep_args->ub = args->ub;
+    sweep_args->x = args->x;
+    sweep_args->iter = args->iter;
+    sweep_args->tol = args->tol;
+    sweep_args->deadline = args->deadline;
+    sweep_args->direct = false;
+    sweep_args->presolve = 0;
+    sweep_args->threads = args->threads;
+
+    //the solver keeps its own compressed rows, so M is dropped before sweeping
+    solver.setup(sweep_args);
+    sweep_args->R.reset();
+    args->M.reset();
+    vector<float> x = solver.solve(sweep_args);
 
     cout<<"quadratic program finished"<<endl;
-    return addVec((*out), args->z);
+    return addVec(x, args->z);
 }
 
 
 
 //Function for computing weighted voxel grid for marching cubes
 //takes as input a binary volume
-gridPtr optimize(gridPtr confGrid, gridPtr volume){
+gridPtr optimize(gridPtr confGrid, gridPtr volume, const qp_options &opts, QPSolver *solver,
+    ZVecCache *cache)
+{
     int BAND_SIZE=4.0;
     //prime quadratic programming arguments
     //prepare margin
@@ -114,10 +56,17 @@ gridPtr optimize(gridPtr confGrid, gridPtr volume){
     vector<int> indexes = findIndexes(bnds->band);
 
     //prepare qp_args
-    qp_argsPtr args = primeQP(confGrid, volume, margin, bnds);
+    qp_argsPtr args = primeQP(confGrid, volume, margin, bnds, opts.threads, cache);
+    args->tol = opts.tol;
+    args->deadline = opts.deadline;
+    args->threads = opts.threads;
 
     //run quadratic programming
-    vector<float> x = runQP(args);
+    vector<float> x;
+    if(solver)
+        x = runQP(args, *solver);
+    else
+        x = runQP(args);
 
 
     //prepare new voxel grid with imbedding function
@@ -2,6 +2,7 @@
 #define QP_CONF_H
 
 #include "primeqp_conf.h"
+#include "quadprog.h"
 
 namespace conf
 {
@@ -9,24 +10,20 @@ namespace conf
 using namespace std;
 using namespace conf;
 
-//more formatting for rapid algorithm
-//takes advantage of sparseness
-vector<int> getIr(SparseMatrixPtr R);
-vector<int> getJc(SparseMatrixPtr R);
-vector<float> getPr(SparseMatrixPtr R);
-
-//row increment
-void doStep(int row, const vector<float> &in, vector<float> &out,
-    const vector<int> &ir, const vector<int> &jc, const vector<float> &pr,
-    const vector<float> &lb, const vector<float> &ub);
-
 //quadratic programming optimization algorithm
 vector<float> runQP(qp_argsPtr args);
+//quadratic programming optimization algorithm using a reusable solver
+//M already carries the inverse diagonal, so it is swept on the cpu with a unit one.
+//M is copied into the solver and dropped from args
+vector<float> runQP(qp_argsPtr args, QPSolver &solver);
 
 
 //Function for computing weighted voxel grid for marching cubes
-//takes as input a binary volume
-gridPtr optimize(gridPtr confGrid, gridPtr volume);
+//takes as input a grid of confidences and its binary volume
+//threads, tol and deadline of opts apply to the sweeps
+//pass a solver to reuse its storage across calls, and a cache to reuse the z solve of the same band
+gridPtr optimize(gridPtr confGrid, gridPtr volume, const qp_options &opts=qp_options(), QPSolver *solver=NULL,
+    ZVecCache *cache=NULL);
 
 }
 
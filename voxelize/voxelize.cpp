@@ -4,17 +4,18 @@
 using namespace std;
 
 float getResolution(pcl::PointCloud<pcl::InterestPoint>::Ptr cloud){
-    //create new cloud missing every ten points
-    pcl::PointCloud<pcl::InterestPoint>::Ptr new_cloud (new pcl::PointCloud<pcl::InterestPoint>());
+    //indexes of the cloud missing every ten points
+    boost::shared_ptr<vector<int> > kept (new vector<int>());
+    kept->reserve(cloud->points.size());
     for(int i=0; i<cloud->points.size(); i++){
         if((i%10)>0){
-            new_cloud->push_back(cloud->points[i]);
+            kept->push_back(i);
         }
     }
 
-    //create kd tree
+    //create kd tree over the kept points in place
     pcl::KdTreeFLANN<pcl::InterestPoint> kdtree;
-    kdtree.setInputCloud(new_cloud);
+    kdtree.setInputCloud(cloud, kept);
 
     float distTotal = 0.0;
     int count = 0;
@@ -84,7 +85,7 @@ void modifyStrengths(pcl::PointCloud<pcl::InterestPoint>::Ptr filtered_cloud,
     }//end of loop through voxel grid
 }
 
-voxelized_dataPtr voxelizeData(pcl::PointCloud<pcl::InterestPoint>::Ptr cloud){
+voxelized_dataPtr voxelizeData(pcl::PointCloud<pcl::InterestPoint>::Ptr cloud, bool keep_input){
     //create dummy object
     pcl::PointCloud<pcl::InterestPoint>::Ptr dummy (new pcl::PointCloud<pcl::InterestPoint>());
 
@@ -97,6 +98,13 @@ voxelized_dataPtr voxelizeData(pcl::PointCloud<pcl::InterestPoint>::Ptr cloud){
     data->grid_data = voxelize(data->input_cloud, data->filtered_cloud, data->resolution);
     data->octree = primeOctree(data->input_cloud, data->resolution);
     modifyStrengths(data->filtered_cloud, data->input_cloud, data->octree);
+    if(!keep_input){
+        //drop every reference to the input, the leaf layout of grid_data is kept
+        data->input_cloud.reset();
+        data->octree.reset();
+        pcl::PointCloud<pcl::InterestPoint>::Ptr empty (new pcl::PointCloud<pcl::InterestPoint>());
+        data->grid_data->setInputCloud(empty);
+    }
     return data;
 }
 
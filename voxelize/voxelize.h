@@ -42,7 +42,9 @@ void modifyStrengths(pcl::PointCloud<pcl::InterestPoint>::Ptr filtered_cloud,
 
 
 //function for creating voxelized point cloud
-voxelized_dataPtr voxelizeData(pcl::PointCloud<pcl::InterestPoint>::Ptr cloud);
+//without keep_input the result holds no reference to cloud, so input_cloud and octree are
+//empty and the cloud is freed once the caller drops it. visualizeData needs the input
+voxelized_dataPtr voxelizeData(pcl::PointCloud<pcl::InterestPoint>::Ptr cloud, bool keep_input=true);
 
 //show point clouds in visualizer
 void visualizeData(voxelized_dataPtr data);